@@ -0,0 +1,14 @@
+# - Try to find liburing
+# Once done this will define
+#
+#  LIBURING_FOUND - system has liburing
+#  LIBURING_INCLUDE_DIRS - the liburing include directory
+#  LIBURING_LIBRARIES - liburing library
+#
+
+find_library(LIBURING_LIBRARIES NAMES uring PATHS ${LIBURING_LIBRARY_DIRS})
+find_path(LIBURING_INCLUDE_DIRS NAMES liburing.h PATHS)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(LIBURING DEFAULT_MSG LIBURING_LIBRARIES LIBURING_INCLUDE_DIRS)
+mark_as_advanced(LIBURING_INCLUDE_DIRS LIBURING_LIBRARIES)
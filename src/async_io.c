@@ -1,30 +1,146 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/socket.h>
 #include <pthread.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+#include "config.h"
 #include "async_io.h"
 #include <ev.h>
 #include <stdbool.h>
 
+#if defined(HAVE_TIMERFD)
+#include <sys/timerfd.h>
+#endif
+
+#if defined(HAVE_LIBURING)
+#include <sys/eventfd.h>
+#include <liburing.h>
+#endif
+
 #define DEFAULT_BUF_SIZE 1024
 
+enum async_io_engine {
+	ASYNC_IO_LIBEV,
+	ASYNC_IO_URING
+};
+
+/* Engine for the socket io of new async_io objects. */
+static enum async_io_engine async_io_engine = ASYNC_IO_LIBEV;
+
+enum async_io_pacing {
+	ASYNC_IO_PACING_TIMER,
+	ASYNC_IO_PACING_TIMERFD
+};
+
+/* Timer that paces writes of new async_io objects. */
+static enum async_io_pacing async_io_pacing = ASYNC_IO_PACING_TIMER;
+
 struct async_io_buf {
 	char *data;
 	size_t size;
 	size_t iter;
 };
 
+/* One socket driven by the event loop of async_io. */
+struct async_io_conn {
+	struct async_io *io_obj;
+	void *conn_data;
+	int sock;
+	struct ev_io r_client;
+	struct ev_io w_client;
+	struct async_io_buf read_buf;
+	struct async_io_buf write_buf;
+	/* Count of really used bytes in write_buf. */
+	size_t buf_busy;
+	/* Count of answers received and requests sent on this socket. */
+	size_t received;
+	size_t need_to_receive;
+	/* Writing is paused because the in-flight window is full. */
+	bool paused;
+	/* io_uring: a send of write_buf is not completed yet. */
+	bool send_inflight;
+	/*
+	 * Count of rps requests of the past ticks that are not sent yet
+	 * because of a pending send or the full in-flight window.
+	 */
+	uint32_t deferred_writes;
+	/* io_uring: index of write_buf in registered buffers or -1. */
+	int buf_index;
+	/* io_uring: the multishot receive is not terminated yet. */
+	bool recv_armed;
+	/* The connection is lost and is being restored. */
+	bool broken;
+	/* Time the connection was lost at. */
+	double broken_since;
+	/* Delay of the next attempt to restore the connection. */
+	double reconnect_delay;
+	struct ev_timer reconnect_timer;
+	/* A helper thread is connecting the socket. */
+	bool connecting;
+	/* Set by the helper thread when connect_sock is ready. */
+	bool connect_done;
+	int connect_sock;
+	pthread_t connect_thread;
+	struct async_io_conn *next;
+};
+
+#if defined(HAVE_LIBURING)
+
+/* Size of the submission queue of one async_io. */
+#define URING_ENTRIES 1024
+/* Count and size of buffers provided to multishot receive. */
+#define URING_BUF_COUNT 256
+#define URING_BUF_SIZE 4096
+#define URING_BUF_GROUP 0
+
+/* Operation kind is stored in the low bit of the completion tag. */
+enum {
+	URING_OP_RECV = 0,
+	URING_OP_SEND = 1
+};
+
+struct async_io_uring {
+	struct io_uring ring;
+	struct io_uring_buf_ring *buf_ring;
+	char *bufs;
+	/* Signaled by the kernel on every completion. */
+	int efd;
+	struct ev_io efd_watcher;
+	/* Submits queued operations before the loop blocks. */
+	struct ev_prepare submit_watcher;
+};
+
+#endif
+
 struct async_io {
 	struct async_io_if io_if;
 	void *user_data;
 	struct ev_loop *loop;
 	bool is_shutdown;
-	int sock;
-	struct ev_io r_client;
-	struct ev_io w_client;
+	struct async_io_conn *conns;
+	int conn_count;
+	/* Connection for that io_if functions are called now. */
+	struct async_io_conn *current;
+	/* Next connection to send a request in the rps mode. */
+	struct async_io_conn *rps_next;
+	/*
+	 * Limits of messages coalesced into one send: count of messages
+	 * and count of bytes after that no more messages are added.
+	 */
+	uint32_t write_batch_count;
+	size_t write_batch_size;
+	/* Max count of requests in flight per connection, 0 - unlimited. */
+	uint32_t max_inflight;
+	/* Initial size of read buffers of connections. */
+	size_t read_buf_size;
+	/* Count of allocations and reallocations of io buffers. */
+	size_t buf_allocs;
 	/* Needed count of requests per second. */
 	uint32_t rps;
 	/*
@@ -32,7 +148,14 @@ struct async_io {
 	 * needed then writes_ps is increasing else is decreasing.
 	 */
 	double writes_ps;
+	/*
+	 * Paces writes in the rps and open-loop modes. It is either
+	 * the libev timer or a timerfd watched by pacer_watcher if
+	 * pacer_fd is not -1.
+	 */
 	struct ev_timer timeout_watcher;
+	int pacer_fd;
+	struct ev_io pacer_watcher;
 	uint32_t req_per_timeout;
 	/*
 	 * This timer every second checks the current rps and
@@ -44,30 +167,130 @@ struct async_io {
 	 * rps_observer.
 	 */
 	uint32_t received_prev;
-	struct async_io_buf read_buf;
 	/*
-	 * If the is_shutdown is set and received == need_to_receive then
-	 * the event loop breaks.
+	 * If set, requests of every tick of the rps mode are claimed
+	 * from an external limiter shared with other async_io objects.
+	 */
+	async_io_limit_f limit;
+	void *limit_arg;
+	/*
+	 * Open-loop mode: requests are fetched while their intended
+	 * send time by the schedule is not in the future.
+	 */
+	bool open_loop;
+	struct async_io_schedule schedule;
+	/* Time when the schedule started. */
+	double sched_start;
+	/* Intended send time of the next request. */
+	double sched_next;
+	/* Intended send time of the request fetched at the moment. */
+	double sched_current;
+	/* State of erand48 for the Poisson arrival. */
+	unsigned short sched_rand[3];
+	/* Calls async_io_if.expire for all connections. */
+	struct ev_timer expire_timer;
+	/* Delays between attempts to restore a lost connection. */
+	double reconnect_delay;
+	double reconnect_max_delay;
+	/* Signaled by helper threads that restored connections. */
+	struct ev_async connect_watcher;
+	/* Count of restored connections and time they were lost. */
+	size_t reconnects;
+	double unavailable;
+	double unavailable_max;
+	/*
+	 * Totals over all connections. If the is_shutdown is set and
+	 * received == need_to_receive then the event loop breaks.
 	 */
 	size_t received;
 	size_t need_to_receive;
-
-	struct async_io_buf write_buf;
-	/* Count of really used bytes in write_buf. */
-	size_t buf_busy;
+#if defined(HAVE_LIBURING)
+	/* Not NULL if the socket io is done by io_uring. */
+	struct async_io_uring *uring;
+#endif
 };
 
+int
+async_io_set_pacing(const char *name)
+{
+	if (strcmp(name, "timer") == 0) {
+		async_io_pacing = ASYNC_IO_PACING_TIMER;
+		return 0;
+	}
+#if defined(HAVE_TIMERFD)
+	if (strcmp(name, "timerfd") == 0) {
+		async_io_pacing = ASYNC_IO_PACING_TIMERFD;
+		return 0;
+	}
+#endif
+	return -1;
+}
+
+int
+async_io_set_engine(const char *name)
+{
+	if (strcmp(name, "libev") == 0) {
+		async_io_engine = ASYNC_IO_LIBEV;
+		return 0;
+	}
+#if defined(HAVE_LIBURING)
+	if (strcmp(name, "io_uring") == 0) {
+		async_io_engine = ASYNC_IO_URING;
+		return 0;
+	}
+#endif
+	return -1;
+}
+
 static int
 async_io_time_to_finish(struct async_io *obj)
 {
 	return obj->is_shutdown && obj->received == obj->need_to_receive;
 }
 
+/**
+ * Return count of requests that can be sent on the connection
+ * without exceeding max_inflight.
+ */
+static inline uint32_t
+async_io_conn_window(struct async_io *obj, struct async_io_conn *conn)
+{
+	if (obj->max_inflight == 0)
+		return UINT32_MAX;
+	size_t inflight = conn->need_to_receive - conn->received;
+	if (inflight >= obj->max_inflight)
+		return 0;
+	return obj->max_inflight - inflight;
+}
+
 static inline void
-async_io_buf_create(struct async_io_buf *buf)
+async_io_buf_create(struct async_io *obj, struct async_io_buf *buf,
+		    size_t size)
+{
+	buf->data = malloc(size);
+	buf->size = size;
+	buf->iter = 0;
+	obj->buf_allocs++;
+}
+
+/**
+ * Grow the buffer to store at least @arg size bytes.
+ * Return true if the buffer was reallocated.
+ */
+static inline bool
+async_io_buf_reserve(struct async_io *obj, struct async_io_buf *buf,
+		     size_t size)
 {
-	buf->data = malloc(DEFAULT_BUF_SIZE);
-	buf->size = DEFAULT_BUF_SIZE;
+	if (size <= buf->size)
+		return false;
+	/* Grow geometrically to make reallocations rare. */
+	size_t new_size = buf->size * 2;
+	if (new_size < size)
+		new_size = size;
+	buf->data = realloc(buf->data, new_size);
+	buf->size = new_size;
+	obj->buf_allocs++;
+	return true;
 }
 
 static inline void
@@ -82,127 +305,451 @@ rps_observer_cb(struct ev_loop *loop, struct ev_timer *timer, int revent);
 static void
 timeout_cb(struct ev_loop *loop, struct ev_timer *timer, int revent);
 
+#if defined(HAVE_TIMERFD)
+
+static void
+pacer_cb(struct ev_loop *loop, struct ev_io *watcher, int revents);
+
+#endif
+
 static void
 write_cb(struct ev_loop *loop, struct ev_io *watcher, int revents);
 
+static void
+expire_cb(struct ev_loop *loop, struct ev_timer *timer, int revents);
+
+static void
+reconnect_cb(struct ev_loop *loop, struct ev_timer *timer, int revents);
+
+static void
+connect_cb(struct ev_loop *loop, struct ev_async *watcher, int revents);
+
+static void
+async_io_conn_lost(struct async_io *obj, struct async_io_conn *conn);
+
 static void
 read_cb(struct ev_loop *loop, struct ev_io *watcher, int revents);
 
+#if defined(HAVE_LIBURING)
+
+static struct async_io_uring *
+async_io_uring_new(struct async_io *obj);
+
+static void
+async_io_uring_delete(struct async_io_uring *uring);
+
+static void
+async_io_uring_start(struct async_io *obj);
+
+static void
+async_io_uring_write(struct async_io *obj, struct async_io_conn *conn,
+		     uint32_t count);
+
+static void
+uring_arm_recv(struct async_io *obj, struct async_io_conn *conn);
+
+#endif
+
 void *
 async_io_get_user_data(struct async_io *obj)
 {
 	return obj->user_data;
 }
 
+void *
+async_io_get_conn_data(struct async_io *obj)
+{
+	assert(obj->current != NULL);
+	return obj->current->conn_data;
+}
+
 static inline struct async_io *
-async_io_new_impl(int sock, struct async_io_if *io_if, void *user_data)
+async_io_new_impl(struct async_io_if *io_if, void *user_data)
 {
 	struct async_io *obj = calloc(1, sizeof(*obj));
+	if (obj == NULL)
+		return NULL;
 	obj->user_data = user_data;
 	obj->io_if = *io_if;
-	obj->sock = sock;
-	fcntl(sock, F_SETFL, O_NONBLOCK);
-	async_io_buf_create(&obj->read_buf);
-	async_io_buf_create(&obj->write_buf);
+	obj->write_batch_count = 1;
+	obj->write_batch_size = DEFAULT_BUF_SIZE;
+	obj->read_buf_size = DEFAULT_BUF_SIZE;
+	obj->pacer_fd = -1;
+	obj->reconnect_delay = 0.1;
+	obj->reconnect_max_delay = 5;
 	obj->loop = ev_loop_new(0);
 	ev_set_userdata(obj->loop, obj);
+	ev_init(&obj->expire_timer, expire_cb);
+	ev_async_init(&obj->connect_watcher, connect_cb);
+	ev_async_start(obj->loop, &obj->connect_watcher);
+#if defined(HAVE_LIBURING)
+	if (async_io_engine == ASYNC_IO_URING) {
+		obj->uring = async_io_uring_new(obj);
+		if (obj->uring == NULL) {
+			ev_loop_destroy(obj->loop);
+			free(obj);
+			return NULL;
+		}
+	}
+#endif
 	return obj;
 }
 
 struct async_io *
-async_io_new(int sock, struct async_io_if *io_if, void *user_data)
+async_io_new(struct async_io_if *io_if, void *user_data)
 {
-	struct async_io *obj = async_io_new_impl(sock, io_if, user_data);
+	return async_io_new_impl(io_if, user_data);
+}
 
-	ev_io_init(&obj->r_client, read_cb, sock, EV_READ);
-	ev_io_init(&obj->w_client, write_cb, sock, EV_WRITE);
-	ev_io_start(obj->loop, &obj->r_client);
-	ev_io_start(obj->loop, &obj->w_client);
-	return obj;
+/**
+ * Prepare the pacing timer of the rps and open-loop modes.
+ */
+static void
+async_io_pacer_init(struct async_io *obj)
+{
+	ev_init(&obj->timeout_watcher, timeout_cb);
+#if defined(HAVE_TIMERFD)
+	if (async_io_pacing != ASYNC_IO_PACING_TIMERFD)
+		return;
+	obj->pacer_fd = timerfd_create(CLOCK_MONOTONIC,
+				       TFD_NONBLOCK | TFD_CLOEXEC);
+	if (obj->pacer_fd == -1) {
+		printf("timerfd_create() failed: %s, using libev timer\n",
+		       strerror(errno));
+		return;
+	}
+	ev_io_init(&obj->pacer_watcher, pacer_cb, obj->pacer_fd, EV_READ);
+	ev_io_start(obj->loop, &obj->pacer_watcher);
+#endif
+}
+
+/**
+ * Return the least interval the pacing timer can wait. Some libev
+ * backends don't support precision less than millisecond, timerfd
+ * is armed with nanoseconds and fires on high resolution timers.
+ */
+static inline double
+async_io_pacer_resolution(struct async_io *obj)
+{
+	return obj->pacer_fd != -1 ? 0.000001 : 0.001;
+}
+
+#if defined(HAVE_TIMERFD)
+
+static inline void
+async_io_timespec(struct timespec *ts, double t)
+{
+	ts->tv_sec = (time_t)t;
+	ts->tv_nsec = (long)((t - (double)ts->tv_sec) * 1e9);
+}
+
+#endif
+
+/**
+ * Arm the pacing timer to fire after @arg after seconds and then
+ * every @arg interval seconds, or only once if @arg interval is 0.
+ */
+static void
+async_io_pacer_set(struct async_io *obj, double after, double interval)
+{
+#if defined(HAVE_TIMERFD)
+	if (obj->pacer_fd != -1) {
+		struct itimerspec its;
+		async_io_timespec(&its.it_value, after);
+		async_io_timespec(&its.it_interval, interval);
+		/* Zero it_value disarms timerfd. */
+		if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0)
+			its.it_value.tv_nsec = 1;
+		timerfd_settime(obj->pacer_fd, 0, &its, NULL);
+		return;
+	}
+#endif
+	ev_timer_stop(obj->loop, &obj->timeout_watcher);
+	ev_timer_set(&obj->timeout_watcher, after, interval);
+	ev_timer_start(obj->loop, &obj->timeout_watcher);
+}
+
+/**
+ * Pace the rps mode by writes_ps: one request per timer tick, or
+ * several requests if the interval between them is less than the
+ * timer resolution.
+ */
+static void
+async_io_rps_pace(struct async_io *obj)
+{
+	double send_interval = 1.0 / obj->writes_ps;
+	double resolution = async_io_pacer_resolution(obj);
+	obj->req_per_timeout = 1;
+	if (send_interval < resolution) {
+		obj->req_per_timeout = resolution / send_interval;
+		send_interval = resolution;
+	}
+	async_io_pacer_set(obj, send_interval, send_interval);
 }
 
 struct async_io *
-async_io_new_rps(int sock, struct async_io_if *io_if,
-		 uint32_t rps, void *user_data)
+async_io_new_rps(struct async_io_if *io_if, uint32_t rps, void *user_data)
 {
-	struct async_io *obj = async_io_new_impl(sock, io_if, user_data);
+	struct async_io *obj = async_io_new_impl(io_if, user_data);
+	if (obj == NULL)
+		return NULL;
 
 	obj->rps = rps;
 	obj->writes_ps = rps;
-	obj->req_per_timeout = 1;
-	ev_io_init(&obj->r_client, read_cb, sock, EV_READ);
-	ev_io_start(obj->loop, &obj->r_client);
-	double send_interval = 1.0 / rps;
-	if (send_interval < 0.001) {
-		/*
-		 * Some libev backends don't support precision less
-		 * than millisecond.
-		 */
-		obj->req_per_timeout = 0.001 / send_interval;
-		send_interval = 0.001;
-	}
-	ev_timer_init(&obj->timeout_watcher, timeout_cb, 0.0, send_interval);
-	ev_timer_start(obj->loop, &obj->timeout_watcher);
+	async_io_pacer_init(obj);
+	async_io_rps_pace(obj);
 	ev_timer_init(&obj->rps_observer, rps_observer_cb, 1.0, 1.0);
 	ev_timer_start(obj->loop, &obj->rps_observer);
 	return obj;
 }
 
+struct async_io *
+async_io_new_open(struct async_io_if *io_if,
+		  const struct async_io_schedule *schedule, void *user_data)
+{
+	struct async_io *obj = async_io_new_impl(io_if, user_data);
+	if (obj == NULL)
+		return NULL;
+	obj->open_loop = true;
+	obj->schedule = *schedule;
+	uint64_t seed = (uint64_t)(uintptr_t)obj ^ (uint64_t)(ev_time() * 1e6);
+	obj->sched_rand[0] = 0x330e;
+	obj->sched_rand[1] = (unsigned short)seed;
+	obj->sched_rand[2] = (unsigned short)(seed >> 16);
+	async_io_pacer_init(obj);
+	return obj;
+}
+
+/**
+ * Return the interval between the intended send times of the
+ * request planned at @arg t and the next one.
+ */
+static double
+async_io_sched_interval(struct async_io *obj, double t)
+{
+	struct async_io_schedule *s = &obj->schedule;
+	double rps = s->rps;
+	switch (s->arrival) {
+	case ASYNC_IO_ARRIVAL_CONSTANT:
+		return 1.0 / rps;
+	case ASYNC_IO_ARRIVAL_POISSON:
+		/* 1 - erand48() is in (0, 1], so the log is finite. */
+		return -log(1.0 - erand48(obj->sched_rand)) / rps;
+	case ASYNC_IO_ARRIVAL_STEP:
+		if (s->step_interval > 0)
+			rps += s->step_rps *
+			       floor((t - obj->sched_start) / s->step_interval);
+		return 1.0 / rps;
+	}
+	return 1.0 / rps;
+}
+
+/**
+ * Take the next request from the schedule if its intended send
+ * time has come. Return false if it is in the future.
+ */
+static inline bool
+async_io_sched_take(struct async_io *obj)
+{
+	if (obj->sched_next > ev_now(obj->loop))
+		return false;
+	obj->sched_current = obj->sched_next;
+	obj->sched_next += async_io_sched_interval(obj, obj->sched_next);
+	return true;
+}
+
+double
+async_io_get_sched_time(struct async_io *obj)
+{
+	if (!obj->open_loop)
+		return -1;
+	return obj->sched_current - obj->sched_start;
+}
+
+void
+async_io_set_limit(struct async_io *obj, async_io_limit_f limit, void *arg)
+{
+	assert(obj->rps != 0);
+	obj->limit = limit;
+	obj->limit_arg = arg;
+	/* The rate is held by the limiter, not by the answers. */
+	ev_timer_stop(obj->loop, &obj->rps_observer);
+}
+
+void
+async_io_set_write_batch(struct async_io *obj, uint32_t count, size_t size)
+{
+	obj->write_batch_count = count > 0 ? count : 1;
+	obj->write_batch_size = size > 0 ? size : 1;
+}
+
+void
+async_io_set_max_inflight(struct async_io *obj, uint32_t max_inflight)
+{
+	obj->max_inflight = max_inflight;
+}
+
+void
+async_io_set_read_buf(struct async_io *obj, size_t size)
+{
+	obj->read_buf_size = size > DEFAULT_BUF_SIZE ? size : DEFAULT_BUF_SIZE;
+}
+
+void
+async_io_set_expire(struct async_io *obj, double interval)
+{
+	ev_timer_stop(obj->loop, &obj->expire_timer);
+	if (interval <= 0)
+		return;
+	ev_timer_set(&obj->expire_timer, interval, interval);
+	ev_timer_start(obj->loop, &obj->expire_timer);
+}
+
+void
+async_io_set_reconnect(struct async_io *obj, double delay, double max_delay)
+{
+	obj->reconnect_delay = delay;
+	obj->reconnect_max_delay = max_delay > delay ? max_delay : delay;
+}
+
+void
+async_io_stat(struct async_io *obj, struct async_io_stat *stat)
+{
+	stat->received = obj->received;
+	stat->buf_allocs = obj->buf_allocs;
+	stat->reconnects = obj->reconnects;
+	stat->unavailable = obj->unavailable;
+	stat->unavailable_max = obj->unavailable_max;
+}
+
+int
+async_io_add(struct async_io *obj, int sock, void *conn_data)
+{
+	struct async_io_conn *conn = calloc(1, sizeof(*conn));
+	if (conn == NULL)
+		return -1;
+	conn->io_obj = obj;
+	conn->conn_data = conn_data;
+	conn->sock = sock;
+	conn->buf_index = -1;
+	fcntl(sock, F_SETFL, O_NONBLOCK);
+	async_io_buf_create(obj, &conn->read_buf, obj->read_buf_size);
+	/*
+	 * A batch may exceed write_batch_size by the last message,
+	 * reserve the space for it to avoid reallocations.
+	 */
+	size_t write_size = DEFAULT_BUF_SIZE;
+	if (obj->write_batch_count > 1)
+		write_size += obj->write_batch_size;
+	async_io_buf_create(obj, &conn->write_buf, write_size);
+	ev_io_init(&conn->r_client, read_cb, sock, EV_READ);
+	conn->r_client.data = conn;
+	ev_io_init(&conn->w_client, write_cb, sock, EV_WRITE);
+	conn->w_client.data = conn;
+	ev_init(&conn->reconnect_timer, reconnect_cb);
+	conn->reconnect_timer.data = conn;
+	conn->next = obj->conns;
+	obj->conns = conn;
+	obj->conn_count++;
+#if defined(HAVE_LIBURING)
+	/* io_uring connections are armed in async_io_start. */
+	if (obj->uring != NULL)
+		return 0;
+#endif
+	ev_io_start(obj->loop, &conn->r_client);
+	/* In the rps and open-loop modes writes are initiated by timers. */
+	if (obj->rps == 0 && !obj->open_loop)
+		ev_io_start(obj->loop, &conn->w_client);
+	return 0;
+}
+
 void
 async_io_delete(struct async_io *obj)
 {
-	async_io_buf_destroy(&obj->read_buf);
-	async_io_buf_destroy(&obj->write_buf);
+	struct async_io_conn *conn = obj->conns, *next;
+#if defined(HAVE_LIBURING)
+	if (obj->uring != NULL)
+		async_io_uring_delete(obj->uring);
+#endif
+	while (conn) {
+		next = conn->next;
+		async_io_buf_destroy(&conn->read_buf);
+		async_io_buf_destroy(&conn->write_buf);
+		free(conn);
+		conn = next;
+	}
+	if (obj->pacer_fd != -1)
+		close(obj->pacer_fd);
 	free(obj);
 }
 
 void
 async_io_start(struct async_io *obj)
 {
+	if (obj->open_loop) {
+		ev_now_update(obj->loop);
+		obj->sched_start = ev_now(obj->loop);
+		obj->sched_next = obj->sched_start;
+		async_io_pacer_set(obj, 0.0, 0.0);
+	}
+#if defined(HAVE_LIBURING)
+	if (obj->uring != NULL)
+		async_io_uring_start(obj);
+#endif
 	ev_loop(obj->loop, 0);
+	/*
+	 * The helper threads signal the loop, wait for them, but not
+	 * longer than the max reconnect delay: a helper stuck in
+	 * connect to a dead server is cancelled, else the run would
+	 * end only after the kernel connect timeout.
+	 */
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	double sec = floor(obj->reconnect_max_delay);
+	deadline.tv_sec += (time_t)sec;
+	deadline.tv_nsec += (long)((obj->reconnect_max_delay - sec) * 1e9);
+	if (deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+	for (struct async_io_conn *conn = obj->conns; conn; conn = conn->next) {
+		if (!conn->connecting)
+			continue;
+		if (pthread_timedjoin_np(conn->connect_thread, NULL,
+					 &deadline) != 0) {
+			pthread_cancel(conn->connect_thread);
+			pthread_join(conn->connect_thread, NULL);
+		}
+		conn->connecting = false;
+	}
 	ev_loop_destroy(obj->loop);
 }
 
-void
-read_cb(struct ev_loop *loop, struct ev_io *watcher, int revents)
+/**
+ * Process all complete messages stored in the read buffer of the
+ * connection and move the remained bytes to the beginning of the
+ * buffer for further processing. The buffer lives as long as the
+ * connection and grows only if a message doesn't fit in it.
+ * Return not 0 if the event loop must be stopped.
+ */
+static int
+async_io_conn_process(struct async_io *io_obj, struct async_io_conn *conn)
 {
-	(void)watcher;
-	(void)revents;
-	struct async_io *io_obj;
-	io_obj = (struct async_io *)ev_userdata(loop);
-	struct async_io_buf *buffer = &io_obj->read_buf;
-	/* Calculate count of free bytes. */
-	size_t need_to_read = buffer->size - buffer->iter;
-	/* Read new bytes in the buffer after already read bytes. */
-	int bytes_read = recv(io_obj->sock, buffer->data +
-			      buffer->iter, need_to_read, 0);
-	if (bytes_read < 0) {
-		/* If an error occured break the event loop. */
-		goto break_loop;
-	}
-	if (bytes_read == 0) return;
-	/*
-	 * Move the buffer iterator for storing new data after this
-	 * position.
-	 */
-	buffer->iter += bytes_read;
+	io_obj->current = conn;
+	struct async_io_buf *buffer = &conn->read_buf;
 	/* Get len of the new message. */
 	int need_len = io_obj->io_if.msg_len(io_obj, buffer->data,
 					     buffer->iter);
-	if (need_len == -1) {
-		goto break_loop;
-	}
+	if (need_len == -1)
+		return -1;
 	/* If need more bytes than already stored then wait for new bytes. */
 	if ((size_t)need_len > buffer->iter) {
 		/*
 		 * Increase the buffer size if need more bytes than can
 		 * be stored.
 		 */
-		if ((size_t)need_len > buffer->size) {
-			buffer->data = realloc(buffer->data, (size_t)need_len);
-			buffer->size = (size_t)need_len;
-		}
-		return;
+		async_io_buf_reserve(io_obj, buffer, (size_t)need_len);
+		return 0;
 	}
 	size_t offset_one;
 	size_t offset = 0;
@@ -212,10 +759,10 @@ read_cb(struct ev_loop *loop, struct ev_io *watcher, int revents)
 		rest = buffer->iter - offset;
 		/* Process the next message. */
 		if (io_obj->io_if.recv_from_buf(io_obj, buffer->data + offset,
-						rest, &offset_one)) {
-			goto break_loop;
-		}
+						rest, &offset_one))
+			return -1;
 		/* Now offset_one contains length of processed message. */
+		conn->received++;
 		io_obj->received++;
 		offset += offset_one;
 		rest -= offset_one;
@@ -223,79 +770,435 @@ read_cb(struct ev_loop *loop, struct ev_io *watcher, int revents)
 		/* Check if the buffer has one more message. */
 		need_len = io_obj->io_if.msg_len(io_obj, buffer->data + offset,
 						 rest);
-		if (need_len == -1) {
-			goto break_loop;
-		}
+		if (need_len == -1)
+			return -1;
 	} while (rest >= need_len);
 	/*
 	 * All messages are processed. Need to save remained bytes for further
-	 * processing.
+	 * processing. Usually it is a small tail of a partial message.
 	 */
-	char *new_buf = malloc(DEFAULT_BUF_SIZE);
-	memcpy(new_buf, buffer->data + offset, buffer->iter - offset);
-	free(buffer->data);
-	buffer->data = new_buf;
-	buffer->size = DEFAULT_BUF_SIZE;
-	buffer->iter = buffer->iter - offset;
+	if (rest > 0)
+		memmove(buffer->data, buffer->data + offset, rest);
+	buffer->iter = rest;
+	if (rest > 0 && (size_t)need_len > buffer->size)
+		async_io_buf_reserve(io_obj, buffer, (size_t)need_len);
+	/*
+	 * Answers have freed the in-flight window, resume writing. In
+	 * the rps mode only the deferred requests are sent, the new
+	 * ones are issued by the next timer tick.
+	 */
+	if (conn->paused && async_io_conn_window(io_obj, conn) > 0) {
+		conn->paused = false;
+		if (io_obj->is_shutdown ||
+		    (io_obj->rps != 0 && conn->deferred_writes == 0))
+			return async_io_time_to_finish(io_obj);
+#if defined(HAVE_LIBURING)
+		if (io_obj->uring != NULL)
+			async_io_uring_write(io_obj, conn, io_obj->rps != 0 ? 0 :
+					     io_obj->write_batch_count);
+		else
+#endif
+		ev_io_start(io_obj->loop, &conn->w_client);
+	}
 	/*
 	 * If no new messages for sending and all answers are received then
 	 * break loop.
 	 */
-	if (async_io_time_to_finish(io_obj)) {
-		goto break_loop;
+	return async_io_time_to_finish(io_obj);
+}
+
+/**
+ * Get new messages for sending if the previous ones are already sent.
+ * Up to @arg count messages are coalesced into write_buf until
+ * write_batch_size bytes are collected or the in-flight window of the
+ * connection is full. In the last case the connection is marked as
+ * paused. In the open-loop mode only the requests whose intended send
+ * time has come are fetched. In the rps mode the requests that are
+ * not fetched are deferred and go first next time.
+ * Return 0 if write_buf has bytes to send, 1 if there is nothing to send.
+ */
+static int
+async_io_conn_fetch(struct async_io *io_obj, struct async_io_conn *conn,
+		    uint32_t count)
+{
+	struct async_io_buf *buffer = &conn->write_buf;
+	if (conn->broken)
+		return 1;
+	if (io_obj->rps != 0) {
+		if (count > UINT32_MAX - conn->deferred_writes)
+			count = UINT32_MAX;
+		else
+			count += conn->deferred_writes;
+		conn->deferred_writes = count;
+	}
+	if (conn->buf_busy != buffer->iter)
+		return 0;
+	conn->buf_busy = 0;
+	buffer->iter = 0;
+	if (io_obj->is_shutdown) {
+		conn->deferred_writes = 0;
+		return 1;
+	}
+	uint32_t window = async_io_conn_window(io_obj, conn);
+	if (count > window)
+		count = window;
+	io_obj->current = conn;
+	uint32_t i;
+	for (i = 0; i < count; i++) {
+		if (conn->buf_busy >= io_obj->write_batch_size)
+			break;
+		if (io_obj->open_loop && !async_io_sched_take(io_obj))
+			break;
+		size_t size = 0;
+		void *new_buf = io_obj->io_if.write(io_obj, &size);
+		if (new_buf == NULL) {
+			/* If no more messages then finish event loop. */
+			async_io_finish(io_obj);
+			break;
+		}
+		conn->need_to_receive++;
+		io_obj->need_to_receive++;
+		if (async_io_buf_reserve(io_obj, buffer,
+					 conn->buf_busy + size)) {
+			/* The registered memory is not used anymore. */
+			conn->buf_index = -1;
+		}
+		memcpy(buffer->data + conn->buf_busy, new_buf, size);
+		conn->buf_busy += size;
+	}
+	if (io_obj->rps != 0)
+		conn->deferred_writes = io_obj->is_shutdown ? 0 :
+					conn->deferred_writes - i;
+	/* An unlimited window is never exhausted. */
+	if (async_io_conn_window(io_obj, conn) == 0)
+		conn->paused = true;
+	return conn->buf_busy == 0;
+}
+
+/**
+ * Send bytes of write_buf by the libev engine, get up to @arg count
+ * new messages before if all bytes are already sent.
+ */
+static void
+async_io_conn_write(struct async_io *io_obj, struct async_io_conn *conn,
+		    uint32_t count)
+{
+	struct async_io_buf *buffer = &conn->write_buf;
+	if (async_io_conn_fetch(io_obj, conn, count)) {
+		if (async_io_time_to_finish(io_obj))
+			goto break_loop;
+		/*
+		 * Wait for answers to free the window, for the
+		 * intended send time of the next request or for the
+		 * next tick of the rps mode.
+		 */
+		if (conn->paused || io_obj->open_loop || io_obj->rps != 0)
+			ev_io_stop(io_obj->loop, &conn->w_client);
+		return;
+	}
+	int bytes_send = send(conn->sock, buffer->data + buffer->iter,
+			      conn->buf_busy - buffer->iter, 0);
+	if (bytes_send < 0) {
+		if (errno != EAGAIN && errno != EINTR)
+			async_io_conn_lost(io_obj, conn);
+		else if (io_obj->rps != 0)
+			ev_io_start(io_obj->loop, &conn->w_client);
+		return;
+	}
+	buffer->iter += bytes_send;
+	if (io_obj->is_shutdown && buffer->iter == conn->buf_busy) {
+		ev_io_stop(io_obj->loop, &conn->w_client);
+	} else if (io_obj->rps != 0 && (buffer->iter != conn->buf_busy ||
+					conn->deferred_writes > 0)) {
+		/*
+		 * Send the rest and the deferred requests as soon as
+		 * the socket is writable, not on the next tick.
+		 */
+		ev_io_start(io_obj->loop, &conn->w_client);
 	}
 	return;
 break_loop:
 	ev_break(io_obj->loop, EVBREAK_ONE);
 }
 
+void
+read_cb(struct ev_loop *loop, struct ev_io *watcher, int revents)
+{
+	(void)revents;
+	struct async_io *io_obj;
+	io_obj = (struct async_io *)ev_userdata(loop);
+	struct async_io_conn *conn = (struct async_io_conn *)watcher->data;
+	struct async_io_buf *buffer = &conn->read_buf;
+	/* Calculate count of free bytes. */
+	size_t need_to_read = buffer->size - buffer->iter;
+	/* Read new bytes in the buffer after already read bytes. */
+	int bytes_read = recv(conn->sock, buffer->data +
+			      buffer->iter, need_to_read, 0);
+	if (bytes_read < 0) {
+		if (errno != EAGAIN && errno != EINTR)
+			async_io_conn_lost(io_obj, conn);
+		return;
+	}
+	if (bytes_read == 0) {
+		/* The server closed the connection. */
+		if (need_to_read > 0)
+			async_io_conn_lost(io_obj, conn);
+		return;
+	}
+	/*
+	 * Move the buffer iterator for storing new data after this
+	 * position.
+	 */
+	buffer->iter += bytes_read;
+	if (async_io_conn_process(io_obj, conn))
+		goto break_loop;
+	return;
+break_loop:
+	ev_break(io_obj->loop, EVBREAK_ONE);
+}
+
 void
 async_io_finish(struct async_io *obj)
 {
+	if (obj->is_shutdown)
+		return;
 	obj->is_shutdown = true;
+	/*
+	 * Nothing new will be sent anymore, so stop watching the sockets
+	 * that have no unsent bytes and wait only for answers.
+	 */
+	for (struct async_io_conn *conn = obj->conns; conn; conn = conn->next) {
+		if (conn->buf_busy == conn->write_buf.iter)
+			ev_io_stop(obj->loop, &conn->w_client);
+	}
 }
 
 void
 write_cb(struct ev_loop *loop, struct ev_io *watcher, int revents)
 {
-	(void)watcher;
 	(void)revents;
 	struct async_io *io_obj;
 	io_obj = (struct async_io *)ev_userdata(loop);
-	struct async_io_buf *buffer = &io_obj->write_buf;
-	int need_to_send = io_obj->buf_busy - buffer->iter;
-	if (need_to_send == 0) {
-		/* If no data for sending then get new message. */
-		size_t size = 0;
-		void *new_buf = io_obj->io_if.write(io_obj, &size);
-		if (new_buf == NULL) {
-			/* If no more messages then finish event loop. */
-			async_io_finish(io_obj);
-			if (async_io_time_to_finish(io_obj))
-				goto break_loop;
+	struct async_io_conn *conn = (struct async_io_conn *)watcher->data;
+	/* In the rps mode only the timer issues new requests. */
+	uint32_t count = io_obj->rps != 0 ? 0 : io_obj->write_batch_count;
+	async_io_conn_write(io_obj, conn, count);
+}
+
+/* Connect the socket of the connection out of the event loop. */
+static void *
+async_io_connect_thread(void *arg)
+{
+	struct async_io_conn *conn = (struct async_io_conn *)arg;
+	struct async_io *obj = conn->io_obj;
+	conn->connect_sock = obj->io_if.reconnect(conn->conn_data);
+	/* Only the connect may be cancelled by async_io_start. */
+	pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+	__atomic_store_n(&conn->connect_done, true, __ATOMIC_RELEASE);
+	ev_async_send(obj->loop, &obj->connect_watcher);
+	return NULL;
+}
+
+static void
+async_io_conn_connected(struct async_io *obj, struct async_io_conn *conn,
+			int sock);
+
+/**
+ * Try to restore the lost connection: async_io_if.disconnect closes
+ * it and async_io_if.reconnect connects it again by a helper thread,
+ * so a slow server doesn't stall the other connections. If it fails
+ * the next attempt is made by the timer after the delay, which is
+ * doubled every time.
+ */
+static void
+async_io_conn_reconnect(struct async_io *obj, struct async_io_conn *conn)
+{
+	if (obj->is_shutdown) {
+		/* Nothing will be sent anymore. */
+		if (async_io_time_to_finish(obj))
+			ev_break(obj->loop, EVBREAK_ONE);
+		return;
+	}
+	if (conn->connecting)
+		return;
+#if defined(HAVE_LIBURING)
+	/* Wait for the operations on the old socket to complete. */
+	if (conn->recv_armed || conn->send_inflight)
+		return;
+#endif
+	obj->current = conn;
+	if (obj->io_if.disconnect(obj) == -1) {
+		async_io_conn_connected(obj, conn, -1);
+		return;
+	}
+	conn->connecting = true;
+	conn->connect_done = false;
+	if (pthread_create(&conn->connect_thread, NULL,
+			   async_io_connect_thread, conn) != 0) {
+		conn->connecting = false;
+		async_io_conn_connected(obj, conn, -1);
+	}
+}
+
+void
+connect_cb(struct ev_loop *loop, struct ev_async *watcher, int revents)
+{
+	(void)watcher;
+	(void)revents;
+	struct async_io *obj = (struct async_io *)ev_userdata(loop);
+	for (struct async_io_conn *conn = obj->conns; conn; conn = conn->next) {
+		if (!conn->connecting ||
+		    !__atomic_load_n(&conn->connect_done, __ATOMIC_ACQUIRE))
+			continue;
+		pthread_join(conn->connect_thread, NULL);
+		conn->connecting = false;
+		async_io_conn_connected(obj, conn, conn->connect_sock);
+	}
+}
+
+/**
+ * Resume the connection on the restored socket, or schedule the
+ * next attempt if @arg sock is -1.
+ */
+static void
+async_io_conn_connected(struct async_io *obj, struct async_io_conn *conn,
+			int sock)
+{
+	ev_now_update(obj->loop);
+	if (sock == -1) {
+		if (obj->is_shutdown) {
+			if (async_io_time_to_finish(obj))
+				ev_break(obj->loop, EVBREAK_ONE);
 			return;
 		}
-		io_obj->need_to_receive++;
-		if (size > buffer->size) {
-			buffer->data = realloc(buffer->data, size);
-			buffer->size = size;
-		}
-		io_obj->buf_busy = size;
-		buffer->iter = 0;
-		memcpy(buffer->data, new_buf, size);
-		need_to_send = size;
+		ev_timer_set(&conn->reconnect_timer, conn->reconnect_delay, 0.0);
+		ev_timer_start(obj->loop, &conn->reconnect_timer);
+		conn->reconnect_delay *= 2;
+		if (conn->reconnect_delay > obj->reconnect_max_delay)
+			conn->reconnect_delay = obj->reconnect_max_delay;
+		return;
 	}
-	int bytes_send = send(io_obj->sock, buffer->data + buffer->iter,
-			      need_to_send, 0);
-	if (bytes_send < 0) {
-		if (errno != EAGAIN)
-			goto break_loop;
+	double gap = ev_now(obj->loop) - conn->broken_since;
+	obj->unavailable += gap;
+	if (gap > obj->unavailable_max)
+		obj->unavailable_max = gap;
+	obj->reconnects++;
+	conn->broken = false;
+	conn->sock = sock;
+	fcntl(sock, F_SETFL, O_NONBLOCK);
+	ev_io_set(&conn->r_client, sock, EV_READ);
+	ev_io_set(&conn->w_client, sock, EV_WRITE);
+	bool write = obj->rps == 0 && !obj->open_loop;
+#if defined(HAVE_LIBURING)
+	if (obj->uring != NULL) {
+		uring_arm_recv(obj, conn);
+		if (write)
+			async_io_uring_write(obj, conn, obj->write_batch_count);
 		return;
 	}
-	buffer->iter += bytes_send;
-	return;
-break_loop:
-	ev_break(io_obj->loop, EVBREAK_ONE);
+#endif
+	ev_io_start(obj->loop, &conn->r_client);
+	if (write)
+		ev_io_start(obj->loop, &conn->w_client);
+}
+
+/**
+ * Forget the requests of the lost connection and start to restore
+ * it. Without async_io_if.disconnect stop the event loop.
+ */
+static void
+async_io_conn_lost(struct async_io *obj, struct async_io_conn *conn)
+{
+	if (obj->io_if.disconnect == NULL) {
+		ev_break(obj->loop, EVBREAK_ONE);
+		return;
+	}
+	if (conn->broken)
+		return;
+	conn->broken = true;
+	conn->broken_since = ev_now(obj->loop);
+	conn->reconnect_delay = obj->reconnect_delay;
+	ev_io_stop(obj->loop, &conn->r_client);
+	ev_io_stop(obj->loop, &conn->w_client);
+#if defined(HAVE_LIBURING)
+	/* Terminate the operations on the socket. */
+	if (obj->uring != NULL)
+		shutdown(conn->sock, SHUT_RDWR);
+#endif
+	conn->deferred_writes = 0;
+	/* Answers to the sent requests will not come. */
+	size_t inflight = conn->need_to_receive - conn->received;
+	conn->need_to_receive = conn->received;
+	obj->need_to_receive -= inflight;
+	conn->read_buf.iter = 0;
+	conn->write_buf.iter = 0;
+	conn->buf_busy = 0;
+	conn->paused = false;
+	async_io_conn_reconnect(obj, conn);
+}
+
+void
+reconnect_cb(struct ev_loop *loop, struct ev_timer *timer, int revents)
+{
+	(void)revents;
+	struct async_io *obj = (struct async_io *)ev_userdata(loop);
+	async_io_conn_reconnect(obj, (struct async_io_conn *)timer->data);
+}
+
+void
+expire_cb(struct ev_loop *loop, struct ev_timer *timer, int revents)
+{
+	(void)timer;
+	(void)revents;
+	struct async_io *obj = (struct async_io *)ev_userdata(loop);
+	if (obj->io_if.expire == NULL)
+		return;
+	for (struct async_io_conn *conn = obj->conns; conn; conn = conn->next) {
+		obj->current = conn;
+		if (obj->io_if.expire(obj) && !conn->broken)
+			async_io_conn_lost(obj, conn);
+	}
+	if (async_io_time_to_finish(obj))
+		ev_break(obj->loop, EVBREAK_ONE);
+}
+
+/**
+ * Open-loop mode: wake up idle connections when the intended send
+ * time of the next request comes. While requests are due, busy
+ * connections fetch them as soon as the previous sends complete.
+ */
+static void
+async_io_sched_wakeup(struct async_io *io_obj)
+{
+	struct ev_loop *loop = io_obj->loop;
+	if (io_obj->is_shutdown)
+		return;
+	for (struct async_io_conn *conn = io_obj->conns; conn;
+	     conn = conn->next) {
+		if (conn->paused || conn->broken)
+			continue;
+#if defined(HAVE_LIBURING)
+		if (io_obj->uring != NULL) {
+			async_io_uring_write(io_obj, conn,
+					     io_obj->write_batch_count);
+			continue;
+		}
+#endif
+		ev_io_start(loop, &conn->w_client);
+	}
+	double after = io_obj->sched_next - ev_now(loop);
+	if (after <= 0) {
+		/*
+		 * Requests are late already and writable connections
+		 * send them as fast as they can. Look at the idle ones
+		 * again in one interval of the schedule.
+		 */
+		after = 1.0 / io_obj->schedule.rps;
+	}
+	double resolution = async_io_pacer_resolution(io_obj);
+	if (after < resolution)
+		after = resolution;
+	async_io_pacer_set(io_obj, after, 0.0);
 }
 
 void
@@ -319,13 +1222,59 @@ rps_observer_cb(struct ev_loop *loop, ev_timer *timer,
 	/* Count of writes per second can't be negative. */
 	if (io_obj->writes_ps < 0)
 		io_obj->writes_ps = io_obj->rps;
-	double send_interval = 1.0 / io_obj->writes_ps;
-	if (send_interval < 0.001) {
-		io_obj->req_per_timeout = 0.001 / send_interval;
-		send_interval = 0.001;
+	async_io_rps_pace(io_obj);
+}
+
+/**
+ * Send @arg total requests of the rps mode.
+ */
+static void
+async_io_rps_write(struct async_io *io_obj, uint32_t total)
+{
+	if (io_obj->conns == NULL)
+		return;
+	/*
+	 * Spread requests of this tick over connections, so every
+	 * connection sends its share by one send. The remainder goes
+	 * to connections in round-robin order.
+	 */
+	uint32_t share = total / io_obj->conn_count;
+	uint32_t extra = total % io_obj->conn_count;
+	if (io_obj->rps_next == NULL)
+		io_obj->rps_next = io_obj->conns;
+	struct async_io_conn *conn = io_obj->rps_next;
+	for (uint32_t i = 0; i < (uint32_t)io_obj->conn_count; ++i) {
+		uint32_t count = share + (i < extra ? 1 : 0);
+		if (count == 0)
+			break;
+#if defined(HAVE_LIBURING)
+		if (io_obj->uring != NULL)
+			async_io_uring_write(io_obj, conn, count);
+		else
+#endif
+		async_io_conn_write(io_obj, conn, count);
+		conn = conn->next != NULL ? conn->next : io_obj->conns;
+		if (i + 1 == extra)
+			io_obj->rps_next = conn;
 	}
-	ev_timer_set(&io_obj->timeout_watcher, send_interval, send_interval);
-	ev_timer_again(io_obj->loop, &io_obj->timeout_watcher);
+}
+
+/**
+ * Handle @arg ticks of the pacing timer.
+ */
+static void
+async_io_pace(struct async_io *io_obj, uint64_t ticks)
+{
+	if (io_obj->open_loop) {
+		async_io_sched_wakeup(io_obj);
+		return;
+	}
+	uint64_t total = ticks * io_obj->req_per_timeout;
+	if (total > UINT32_MAX)
+		total = UINT32_MAX;
+	if (io_obj->limit != NULL)
+		total = io_obj->limit(io_obj->limit_arg, total);
+	async_io_rps_write(io_obj, total);
 }
 
 void
@@ -333,8 +1282,332 @@ timeout_cb(struct ev_loop *loop, ev_timer *timer, int revent)
 {
 	(void) timer;
 	(void) revent;
-	struct async_io *io_obj;
-	io_obj = (struct async_io *)ev_userdata(loop);
-	for (uint32_t i = 0; i < io_obj->req_per_timeout; ++i)
-		write_cb(loop, &io_obj->w_client, 0);
+	async_io_pace((struct async_io *)ev_userdata(loop), 1);
+}
+
+#if defined(HAVE_TIMERFD)
+
+void
+pacer_cb(struct ev_loop *loop, struct ev_io *watcher, int revents)
+{
+	(void)revents;
+	uint64_t ticks;
+	/*
+	 * The count of expirations since the last read, so the ticks
+	 * missed while the loop was busy are not lost.
+	 */
+	if (read(watcher->fd, &ticks, sizeof(ticks)) != sizeof(ticks))
+		return;
+	async_io_pace((struct async_io *)ev_userdata(loop), ticks);
 }
+
+#endif
+
+#if defined(HAVE_LIBURING)
+
+/*
+ * The io_uring engine keeps libev as the event loop for timers and
+ * replaces only the socket io: every connection has one multishot
+ * receive into the provided buffers and at most one send of its
+ * write buffer in flight. Operations queued during a loop iteration
+ * are submitted by one syscall before the loop blocks, completions
+ * are signaled through an eventfd watched by libev.
+ */
+
+static inline uint64_t
+uring_tag(struct async_io_conn *conn, int op)
+{
+	return (uint64_t)(uintptr_t)conn | op;
+}
+
+/*
+ * Get a free submission queue entry, flushing the queue when it is
+ * full. Returns NULL and stops the loop if the kernel refuses to
+ * consume the queue.
+ */
+static struct io_uring_sqe *
+uring_get_sqe(struct async_io *obj)
+{
+	struct io_uring *ring = &obj->uring->ring;
+	struct io_uring_sqe *sqe = io_uring_get_sqe(ring);
+	int attempts = 0;
+	while (sqe == NULL) {
+		/* The submission queue is full, flush it. */
+		int rc = io_uring_submit(ring);
+		if (rc < 0 && rc != -EINTR && rc != -EAGAIN && rc != -EBUSY) {
+			printf("io_uring_submit() failed: %s\n", strerror(-rc));
+			break;
+		}
+		if (++attempts == 16) {
+			printf("io_uring submission queue is stuck\n");
+			break;
+		}
+		sqe = io_uring_get_sqe(ring);
+	}
+	if (sqe == NULL)
+		ev_break(obj->loop, EVBREAK_ONE);
+	return sqe;
+}
+
+static void
+uring_arm_recv(struct async_io *obj, struct async_io_conn *conn)
+{
+	struct io_uring_sqe *sqe = uring_get_sqe(obj);
+	if (sqe == NULL)
+		return;
+	io_uring_prep_recv_multishot(sqe, conn->sock, NULL, 0, 0);
+	sqe->flags |= IOSQE_BUFFER_SELECT;
+	sqe->buf_group = URING_BUF_GROUP;
+	io_uring_sqe_set_data64(sqe, uring_tag(conn, URING_OP_RECV));
+	conn->recv_armed = true;
+}
+
+static void
+async_io_uring_write(struct async_io *obj, struct async_io_conn *conn,
+		     uint32_t count)
+{
+	if (conn->send_inflight) {
+		if (obj->rps != 0 && !conn->broken) {
+			if (count > UINT32_MAX - conn->deferred_writes)
+				conn->deferred_writes = UINT32_MAX;
+			else
+				conn->deferred_writes += count;
+		}
+		return;
+	}
+	if (async_io_conn_fetch(obj, conn, count)) {
+		if (async_io_time_to_finish(obj))
+			ev_break(obj->loop, EVBREAK_ONE);
+		return;
+	}
+	struct async_io_buf *buffer = &conn->write_buf;
+	struct io_uring_sqe *sqe = uring_get_sqe(obj);
+	if (sqe == NULL)
+		return;
+	if (conn->buf_index >= 0) {
+		io_uring_prep_write_fixed(sqe, conn->sock,
+					  buffer->data + buffer->iter,
+					  conn->buf_busy - buffer->iter, 0,
+					  conn->buf_index);
+	} else {
+		io_uring_prep_send(sqe, conn->sock, buffer->data + buffer->iter,
+				   conn->buf_busy - buffer->iter, 0);
+	}
+	io_uring_sqe_set_data64(sqe, uring_tag(conn, URING_OP_SEND));
+	conn->send_inflight = true;
+}
+
+/* Give the provided buffer back to the kernel. */
+static inline void
+uring_buf_put(struct async_io_uring *uring, char *data, unsigned short bid)
+{
+	io_uring_buf_ring_add(uring->buf_ring, data, URING_BUF_SIZE, bid,
+			      io_uring_buf_ring_mask(URING_BUF_COUNT), 0);
+	io_uring_buf_ring_advance(uring->buf_ring, 1);
+}
+
+static int
+uring_recv_complete(struct async_io *obj, struct async_io_conn *conn,
+		    struct io_uring_cqe *cqe)
+{
+	struct async_io_uring *uring = obj->uring;
+	if (!(cqe->flags & IORING_CQE_F_MORE))
+		conn->recv_armed = false;
+	char *data = NULL;
+	unsigned short bid = 0;
+	if (cqe->res > 0) {
+		assert(cqe->flags & IORING_CQE_F_BUFFER);
+		bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+		data = uring->bufs + (size_t)bid * URING_BUF_SIZE;
+	}
+	if (conn->broken) {
+		/* The rest of the lost socket, drop it. */
+		if (data != NULL)
+			uring_buf_put(uring, data, bid);
+		async_io_conn_reconnect(obj, conn);
+		return 0;
+	}
+	if (cqe->res == -ENOBUFS) {
+		/* All buffers are busy, data is still in the socket. */
+		if (!conn->recv_armed)
+			uring_arm_recv(obj, conn);
+		return 0;
+	}
+	if (cqe->res <= 0) {
+		async_io_conn_lost(obj, conn);
+		return async_io_time_to_finish(obj);
+	}
+	size_t size = (size_t)cqe->res;
+	struct async_io_buf *buffer = &conn->read_buf;
+	async_io_buf_reserve(obj, buffer, buffer->iter + size);
+	memcpy(buffer->data + buffer->iter, data, size);
+	buffer->iter += size;
+	uring_buf_put(uring, data, bid);
+	if (!conn->recv_armed)
+		uring_arm_recv(obj, conn);
+	return async_io_conn_process(obj, conn);
+}
+
+static int
+uring_send_complete(struct async_io *obj, struct async_io_conn *conn,
+		    struct io_uring_cqe *cqe)
+{
+	conn->send_inflight = false;
+	if (conn->broken) {
+		async_io_conn_reconnect(obj, conn);
+		return 0;
+	}
+	if (cqe->res < 0 && cqe->res != -EAGAIN) {
+		async_io_conn_lost(obj, conn);
+		return async_io_time_to_finish(obj);
+	}
+	if (cqe->res > 0)
+		conn->write_buf.iter += cqe->res;
+	if (conn->write_buf.iter != conn->buf_busy) {
+		/* Send the rest of the messages. */
+		async_io_uring_write(obj, conn, 0);
+	} else if (obj->rps == 0) {
+		/*
+		 * Without rps limit send requests continuously. In the
+		 * open-loop mode only the due ones are fetched.
+		 */
+		async_io_uring_write(obj, conn, obj->write_batch_count);
+	} else if (conn->deferred_writes > 0) {
+		/* The deferred requests are fetched first. */
+		async_io_uring_write(obj, conn, 0);
+	}
+	return async_io_time_to_finish(obj);
+}
+
+static void
+uring_complete_cb(struct ev_loop *loop, struct ev_io *watcher, int revents)
+{
+	(void)revents;
+	struct async_io *obj = (struct async_io *)ev_userdata(loop);
+	struct async_io_uring *uring = obj->uring;
+	uint64_t events;
+	if (read(watcher->fd, &events, sizeof(events)) < 0 && errno != EAGAIN)
+		goto break_loop;
+	struct io_uring_cqe *cqe;
+	unsigned head;
+	unsigned count = 0;
+	int rc = 0;
+	io_uring_for_each_cqe(&uring->ring, head, cqe) {
+		count++;
+		uint64_t tag = io_uring_cqe_get_data64(cqe);
+		struct async_io_conn *conn =
+			(struct async_io_conn *)(uintptr_t)(tag & ~1ull);
+		if ((tag & 1) == URING_OP_RECV)
+			rc = uring_recv_complete(obj, conn, cqe);
+		else
+			rc = uring_send_complete(obj, conn, cqe);
+		if (rc)
+			break;
+	}
+	io_uring_cq_advance(&uring->ring, count);
+	if (rc)
+		goto break_loop;
+	return;
+break_loop:
+	ev_break(obj->loop, EVBREAK_ONE);
+}
+
+static void
+uring_submit_cb(struct ev_loop *loop, struct ev_prepare *watcher, int revents)
+{
+	(void)revents;
+	(void)loop;
+	struct async_io_uring *uring = (struct async_io_uring *)watcher->data;
+	if (io_uring_sq_ready(&uring->ring) > 0)
+		io_uring_submit(&uring->ring);
+}
+
+static struct async_io_uring *
+async_io_uring_new(struct async_io *obj)
+{
+	struct async_io_uring *uring = calloc(1, sizeof(*uring));
+	if (uring == NULL)
+		return NULL;
+	uring->efd = -1;
+	int rc = io_uring_queue_init(URING_ENTRIES, &uring->ring, 0);
+	if (rc < 0) {
+		printf("io_uring_queue_init() failed: %s\n", strerror(-rc));
+		free(uring);
+		return NULL;
+	}
+	uring->buf_ring = io_uring_setup_buf_ring(&uring->ring, URING_BUF_COUNT,
+						  URING_BUF_GROUP, 0, &rc);
+	if (uring->buf_ring == NULL) {
+		printf("io_uring_setup_buf_ring() failed: %s\n", strerror(-rc));
+		goto error;
+	}
+	uring->bufs = malloc((size_t)URING_BUF_COUNT * URING_BUF_SIZE);
+	if (uring->bufs == NULL)
+		goto error;
+	for (int i = 0; i < URING_BUF_COUNT; i++) {
+		io_uring_buf_ring_add(uring->buf_ring,
+				      uring->bufs + (size_t)i * URING_BUF_SIZE,
+				      URING_BUF_SIZE, i,
+				      io_uring_buf_ring_mask(URING_BUF_COUNT), i);
+	}
+	io_uring_buf_ring_advance(uring->buf_ring, URING_BUF_COUNT);
+	uring->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (uring->efd == -1 ||
+	    io_uring_register_eventfd(&uring->ring, uring->efd) < 0)
+		goto error;
+	ev_io_init(&uring->efd_watcher, uring_complete_cb, uring->efd, EV_READ);
+	ev_io_start(obj->loop, &uring->efd_watcher);
+	ev_prepare_init(&uring->submit_watcher, uring_submit_cb);
+	uring->submit_watcher.data = uring;
+	ev_prepare_start(obj->loop, &uring->submit_watcher);
+	return uring;
+error:
+	async_io_uring_delete(uring);
+	return NULL;
+}
+
+static void
+async_io_uring_delete(struct async_io_uring *uring)
+{
+	if (uring->buf_ring != NULL) {
+		io_uring_free_buf_ring(&uring->ring, uring->buf_ring,
+				       URING_BUF_COUNT, URING_BUF_GROUP);
+	}
+	io_uring_queue_exit(&uring->ring);
+	if (uring->efd != -1)
+		close(uring->efd);
+	free(uring->bufs);
+	free(uring);
+}
+
+static void
+async_io_uring_start(struct async_io *obj)
+{
+	struct async_io_uring *uring = obj->uring;
+	/*
+	 * Register write buffers of all connections, so the kernel
+	 * doesn't map them on every send. If it fails (for example,
+	 * due to RLIMIT_MEMLOCK) plain sends are used.
+	 */
+	struct iovec *iov = calloc(obj->conn_count, sizeof(*iov));
+	int i = 0;
+	struct async_io_conn *conn;
+	for (conn = obj->conns; conn != NULL && iov != NULL; conn = conn->next) {
+		iov[i].iov_base = conn->write_buf.data;
+		iov[i].iov_len = conn->write_buf.size;
+		conn->buf_index = i++;
+	}
+	if (iov == NULL ||
+	    io_uring_register_buffers(&uring->ring, iov, obj->conn_count) < 0) {
+		for (conn = obj->conns; conn != NULL; conn = conn->next)
+			conn->buf_index = -1;
+	}
+	free(iov);
+	for (conn = obj->conns; conn != NULL; conn = conn->next) {
+		uring_arm_recv(obj, conn);
+		if (obj->rps == 0 && !obj->open_loop)
+			async_io_uring_write(obj, conn, obj->write_batch_count);
+	}
+}
+
+#endif
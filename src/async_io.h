@@ -32,9 +32,11 @@
 
 /**
  * There is described API for making asynchronous reading and writing
- * to socket in one thread.
+ * to one or more sockets in one thread.
  *
  * async_io - a main structure that is used for managing async io.
+ * It owns an event loop which drives all connections that were
+ * attached to it by async_io_add.
  */
 struct async_io;
 
@@ -44,6 +46,8 @@ struct async_io;
  *   - for getting new messages and send them to network
  *   - for parsing this messages
  * The user of async_io must implement this interface.
+ * All functions are called in context of some connection, the
+ * data of this connection can be retrieved by async_io_get_conn_data.
  */
 struct async_io_if {
 	/**
@@ -62,11 +66,60 @@ struct async_io_if {
 	 */
 	int (*recv_from_buf)(struct async_io *obj, char *buf,
 			     size_t size, size_t *off);
+	/**
+	 * Optional. Called periodically (@sa async_io_set_expire) for
+	 * every connection to expire requests that wait for an answer
+	 * too long. Return not 0 to drop the connection, the answers of
+	 * its requests are not waited anymore.
+	 */
+	int (*expire)(struct async_io *obj);
+	/**
+	 * Optional. Called when the connection is lost or dropped and
+	 * before every attempt to restore it. Must forget the requests
+	 * sent on the connection and close its socket. Return -1 to
+	 * stop restoring it. Without this function a lost connection
+	 * stops the event loop.
+	 */
+	int (*disconnect)(struct async_io *obj);
+	/**
+	 * Required with disconnect. Return a new connected socket of
+	 * the connection of @arg conn_data, or -1 to retry later with
+	 * growing delays. Connecting may block, so it is called by a
+	 * helper thread, not by the event loop, and must not touch the
+	 * state the loop uses. The thread is cancelled if it is still
+	 * connecting reconnect_max_delay after the loop ends.
+	 */
+	int (*reconnect)(void *conn_data);
 };
 
 /**
- * Allocate and initialize new async_io.
- * @arg sock      - socket for reading and writing to it.
+ * Select the engine that performs the socket io of all async_io
+ * objects created after this call:
+ *   - "libev"    - recv()/send() on socket readiness (default);
+ *   - "io_uring" - multishot receive into provided buffers and sends
+ *     from registered buffers, all batched into one submission per
+ *     event loop iteration (only if built with liburing).
+ * Timers of the rps mode are served by libev for both engines.
+ * Return 0 on success, -1 if the engine is unknown or not supported.
+ */
+int
+async_io_set_engine(const char *name);
+
+/**
+ * Select the timer that paces writes in the rps and open-loop
+ * modes of all async_io objects created after this call:
+ *   - "timer"   - libev timer (default). Its precision is one
+ *     millisecond, so higher rates are sent by bursts once per
+ *     millisecond;
+ *   - "timerfd" - Linux timerfd watched by the event loop, it fires
+ *     with microsecond precision and spaces requests evenly.
+ * Return 0 on success, -1 if the timer is unknown or not supported.
+ */
+int
+async_io_set_pacing(const char *name);
+
+/**
+ * Allocate and initialize new async_io without connections.
  * @arg io_if     - an implemented interface for working with the bytes stream
  *   (@sa struct async_io_if).
  * @arg user_data - any user defined data or NULL. Further the user_data can
@@ -74,12 +127,12 @@ struct async_io_if {
  *   async_io_get_user_data.
  */
 struct async_io *
-async_io_new(int sock, struct async_io_if *io_if, void *user_data);
+async_io_new(struct async_io_if *io_if, void *user_data);
 
 /**
  * Allocate and initialize new async_io that after starting will be
- * trying to support defined RPS (requests per second).
- * @arg sock      - socket for reading and writing to it.
+ * trying to support defined RPS (requests per second). The requests
+ * are spread over all connections in round-robin order.
  * @arg io_if     - an implemented interface for working with the bytes stream
  *   (@sa struct async_io_if).
  * @arg rps       - needed count of requests per second
@@ -88,8 +141,113 @@ async_io_new(int sock, struct async_io_if *io_if, void *user_data);
  *   async_io_get_user_data.
  */
 struct async_io *
-async_io_new_rps(int sock, struct async_io_if *io_if,
-					 uint32_t rps, void *user_data);
+async_io_new_rps(struct async_io_if *io_if, uint32_t rps, void *user_data);
+
+/**
+ * Return how many of @arg count requests may be sent now.
+ */
+typedef uint32_t (*async_io_limit_f)(void *arg, uint32_t count);
+
+/**
+ * Make the rps mode claim the requests of every timer tick from
+ * @arg limit, so several async_io objects share one rate. The rps
+ * of async_io becomes the max rate it can claim, the correction of
+ * the rate by received answers is turned off.
+ */
+void
+async_io_set_limit(struct async_io *obj, async_io_limit_f limit, void *arg);
+
+/**
+ * Arrival processes of the open-loop mode.
+ */
+enum async_io_arrival {
+	/* Requests are evenly spaced by 1 / rps. */
+	ASYNC_IO_ARRIVAL_CONSTANT,
+	/* Intervals are exponentially distributed with mean 1 / rps. */
+	ASYNC_IO_ARRIVAL_POISSON,
+	/* Evenly spaced, rps grows by step_rps every step_interval. */
+	ASYNC_IO_ARRIVAL_STEP
+};
+
+struct async_io_schedule {
+	enum async_io_arrival arrival;
+	/* Requests per second at start. */
+	double rps;
+	/* Increment of rps and its period in seconds (step arrival). */
+	double step_rps;
+	double step_interval;
+};
+
+/**
+ * Allocate and initialize new async_io in the open-loop mode: every
+ * request has an intended send time given by @arg schedule, which
+ * doesn't depend on answers of the server. If a connection can't
+ * send in time (the socket is not writable or the in-flight window
+ * is full) the requests are not skipped but sent later, and the
+ * intended send time is available by async_io_get_sched_time, so a
+ * server stall shows up in latency instead of lowering the request
+ * rate.
+ * The requests are spread over all connections.
+ */
+struct async_io *
+async_io_new_open(struct async_io_if *io_if,
+		  const struct async_io_schedule *schedule, void *user_data);
+
+/**
+ * Allow one send to carry several messages: when all bytes of the
+ * previous send are written, up to @arg count new messages are
+ * fetched by async_io_if.write and coalesced until @arg size bytes
+ * are collected. In the rps mode the messages of one timer tick are
+ * coalesced regardless of @arg count. By default every message is
+ * sent separately. Must be called before async_io_add.
+ */
+void
+async_io_set_write_batch(struct async_io *obj, uint32_t count, size_t size);
+
+/**
+ * Limit count of requests sent on one connection and not answered
+ * yet. When the window is full writing to the connection is paused
+ * until answers arrive, so latency is measured at a fixed
+ * concurrency instead of including queueing inside the client.
+ * 0 means unlimited (default).
+ */
+void
+async_io_set_max_inflight(struct async_io *obj, uint32_t max_inflight);
+
+/**
+ * Set the size of read buffers of connections. A read buffer is
+ * allocated once per connection and grows only if a message doesn't
+ * fit in it. Must be called before async_io_add.
+ */
+void
+async_io_set_read_buf(struct async_io *obj, size_t size);
+
+/**
+ * Call async_io_if.expire for all connections every @arg interval
+ * seconds. 0 means never (default).
+ */
+void
+async_io_set_expire(struct async_io *obj, double interval);
+
+/**
+ * Set the delay before the second attempt to restore a lost
+ * connection, every next attempt waits twice longer up to
+ * @arg max_delay seconds. The first attempt is made at once.
+ */
+void
+async_io_set_reconnect(struct async_io *obj, double delay, double max_delay);
+
+/**
+ * Attach a new connection to the async_io. Every connection has its
+ * own read and write buffers and its own counter of pending answers.
+ * @arg sock      - socket for reading and writing to it.
+ * @arg conn_data - any user defined data or NULL. It can be retrieved
+ *   by calling async_io_get_conn_data while a function of the
+ *   async_io_if is called for this connection.
+ * Return 0 on success, -1 on error.
+ */
+int
+async_io_add(struct async_io *obj, int sock, void *conn_data);
 
 /**
  * Return the data that was passed to async_io_new as @arg user_data.
@@ -98,7 +256,45 @@ void *
 async_io_get_user_data(struct async_io *obj);
 
 /**
- * Start event loop that blocks current thread and listens socket on
+ * Return the data that was passed to async_io_add as @arg conn_data
+ * for the connection that is processed at the moment.
+ */
+void *
+async_io_get_conn_data(struct async_io *obj);
+
+/**
+ * Return the intended send time of the request that is fetched by
+ * async_io_if.write at the moment, in seconds since the schedule
+ * started by async_io_start. The offset doesn't depend on the clock
+ * of the event loop, so the caller adds it to the start time by its
+ * own clock. Always -1 if async_io is not in the open-loop mode.
+ */
+double
+async_io_get_sched_time(struct async_io *obj);
+
+/**
+ * Counters of async_io, summed over all connections.
+ */
+struct async_io_stat {
+	/* Count of received messages. */
+	size_t received;
+	/* Count of allocations and reallocations of io buffers. */
+	size_t buf_allocs;
+	/* Count of restored connections. */
+	size_t reconnects;
+	/*
+	 * Seconds connections were lost, summed over connections,
+	 * and the longest loss of one connection.
+	 */
+	double unavailable;
+	double unavailable_max;
+};
+
+void
+async_io_stat(struct async_io *obj, struct async_io_stat *stat);
+
+/**
+ * Start event loop that blocks current thread and listens sockets on
  * writing or reading bytes capability.
  */
 void
@@ -112,7 +308,7 @@ void
 async_io_finish(struct async_io *obj);
 
 /**
- * Free memory allocated in async_io_new.
+ * Free memory allocated in async_io_new and async_io_add.
  */
 void
 async_io_delete(struct async_io *obj);
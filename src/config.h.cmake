@@ -9,5 +9,7 @@
 #cmakedefine HAVE_LEVELDB 1
 #cmakedefine HAVE_NESSDB_V1 1
 #cmakedefine HAVE_NESSDB_V2 1
+#cmakedefine HAVE_LIBURING 1
+#cmakedefine HAVE_TIMERFD 1
 
 #endif /* NB_CONFIG_H_INCLUDED */
@@ -39,8 +39,10 @@
 #include <unistd.h>
 #include <signal.h>
 #include <pthread.h>
+#include <time.h>
 
 #include "nosqlbench.h"
+#include "async_io.h"
 
 struct nb nb;
 
@@ -106,11 +108,65 @@ static void nb_validate(void)
 			nb.opts.latency_units = NB_LATENCY_MICSECS;
 		else if (!strcmp(nb.opts.latency_measure_units, "sec"))
 			nb.opts.latency_units = NB_LATENCY_SECS;
+		else if (!strcmp(nb.opts.latency_measure_units, "nanosec"))
+			nb.opts.latency_units = NB_LATENCY_NANOSECS;
 		else
 			nb_error("bad latency measure units '%s'",
 				nb.opts.latency_measure_units);
-		nb.opts.get_time = time_functions[nb.opts.latency_units];
 	}
+	nb.opts.get_time = nb_time_source_match(nb.opts.time_source);
+	if (nb.opts.get_time == NULL)
+		nb_error("time source '%s' is not supported",
+			 nb.opts.time_source);
+	if (nb.opts.rps_arrival_name) {
+		if (!strcmp(nb.opts.rps_arrival_name, "adaptive"))
+			nb.opts.rps_arrival = NB_RPS_ADAPTIVE;
+		else if (!strcmp(nb.opts.rps_arrival_name, "constant"))
+			nb.opts.rps_arrival = NB_RPS_CONSTANT;
+		else if (!strcmp(nb.opts.rps_arrival_name, "poisson"))
+			nb.opts.rps_arrival = NB_RPS_POISSON;
+		else if (!strcmp(nb.opts.rps_arrival_name, "step"))
+			nb.opts.rps_arrival = NB_RPS_STEP;
+		else
+			nb_error("bad rps arrival '%s'",
+				 nb.opts.rps_arrival_name);
+	}
+	if (nb.opts.rps_arrival != NB_RPS_ADAPTIVE) {
+		if (nb.opts.rps <= 0)
+			nb_error("rps_arrival '%s' requires rps",
+				 nb.opts.rps_arrival_name);
+		if (nb.opts.request_batch_count)
+			nb_error("rps_arrival '%s' requires "
+				 "request_batch_count 0",
+				 nb.opts.rps_arrival_name);
+	}
+	if (nb.opts.rps_arrival == NB_RPS_STEP &&
+	    nb.opts.rps_step_interval <= 0)
+		nb_error("bad rps_step_interval");
+	if (nb.opts.total_rps < 0)
+		nb_error("bad total_rps");
+	if (nb.opts.total_rps) {
+		if (nb.opts.rps)
+			nb_error("rps and total_rps are mutually exclusive");
+		if (nb.opts.request_batch_count)
+			nb_error("total_rps requires request_batch_count 0");
+	}
+	if (async_io_set_pacing(nb.opts.rps_pacing) == -1)
+		nb_error("rps pacing '%s' is not supported",
+			 nb.opts.rps_pacing);
+	/* Print the seed of a run to allow to reproduce it. */
+	if (nb.opts.random_seed == 0)
+		nb.opts.random_seed = (int)(time(NULL) & 0x7fffffff);
+	if (nb.opts.request_timeout < 0)
+		nb_error("bad request_timeout");
+	if (nb.opts.request_timeout && nb.opts.request_batch_count)
+		nb_error("request_timeout requires request_batch_count 0");
+	if (nb.opts.reconnect_delay < 0 || nb.opts.reconnect_max_delay < 0)
+		nb_error("bad reconnect delay");
+	if (nb.opts.histogram_digits < 1 || nb.opts.histogram_digits > 5)
+		nb_error("histogram_digits must be from 1 to 5");
+	if (async_io_set_engine(nb.opts.io_engine) == -1)
+		nb_error("io engine '%s' is not supported", nb.opts.io_engine);
 	/* matching and validation specified interfaces */
 	nb.db = nb_db_match(nb.opts.db);
 	if (nb.db == NULL)
@@ -118,24 +174,109 @@ static void nb_validate(void)
 	nb.key = nb_key_match(nb.opts.key);
 	if (nb.key == NULL)
 		nb_error("key interface '%s' not found", nb.opts.key);
+	if (nb_key_string_config(nb.opts.key_prefix, nb.opts.key_length) == -1)
+		nb_error("key_length %d doesn't fit a digit after "
+			 "key_prefix '%s'", nb.opts.key_length,
+			 nb.opts.key_prefix);
+	/* A profile overrides the request percents and distribution. */
+	if (nb.opts.workload_profile &&
+	    nb_opt_profile(&nb.opts, nb.opts.workload_profile) == -1)
+		nb_error("workload profile '%s' not found",
+			 nb.opts.workload_profile);
 	nb.key_dist = nb_key_distribution_match(nb.opts.key_dist);
-	if (nb.key == NULL)
+	if (nb.key_dist == NULL)
 		nb_error("key distribution interface '%s' not found", nb.opts.key_dist);
 	nb.report = nb_report_match(nb.opts.report);
 	if (nb.report == NULL)
 		nb_error("report interface '%s' not found", nb.opts.report);
+	if (nb.opts.key_hotspot_keys <= 0 || nb.opts.key_hotspot_keys > 100 ||
+	    nb.opts.key_hotspot_ops < 0 || nb.opts.key_hotspot_ops > 100)
+		nb_error("key_hotspot_keys and key_hotspot_ops must be "
+			 "percents");
 	/* validating request distributions */
-	if (nb.opts.request_count == 0)
+	if (nb.opts.request_count <= 0)
 		nb_error("bad request distribution");
+	uint64_t id_limit = nb_key_id_limit(nb.key);
+	nb.key_id_limit = id_limit;
+	if (id_limit && (uint64_t)nb.opts.request_count > id_limit)
+		nb_error("request_count %" PRId64 " exceeds %" PRIu64
+			 " distinct keys of key type '%s'",
+			 nb.opts.request_count, id_limit, nb.opts.key);
 	int dist = nb.opts.dist_replace + nb.opts.dist_update +
 		   nb.opts.dist_select +
-		   nb.opts.dist_delete;
+		   nb.opts.dist_delete + nb.opts.dist_insert +
+		   nb.opts.dist_scan + nb.opts.dist_multi_select +
+		   nb.opts.dist_multi_replace + nb.opts.dist_rmw;
 	if (dist <= 0)
 		nb_error("bad request distribution");
 	if (dist < 100)
 		nb_error("request distribution is lower than 100%");
 	if (dist > 100)
 		nb_error("request distribution is higher than 100%");
+	if ((nb.opts.dist_replace && nb.db->replace == NULL) ||
+	    (nb.opts.dist_update && nb.db->update == NULL &&
+	     nb.db->replace == NULL) ||
+	    (nb.opts.dist_select && nb.db->select == NULL) ||
+	    (nb.opts.dist_delete && nb.db->del == NULL) ||
+	    (nb.opts.dist_insert && nb.db->insert == NULL))
+		nb_error("db driver '%s' doesn't support the request types "
+			 "of the distribution", nb.opts.db);
+	/* validating values */
+	if (nb.opts.value_size <= 0)
+		nb_error("bad value_size");
+	if (!strcmp(nb.opts.value_size_dist, "histogram")) {
+		if (nb.opts.value_size_histogram == NULL ||
+		    nb_dist_load(&nb.value_size,
+				 nb.opts.value_size_histogram) == -1)
+			nb_error("can't read value_size_histogram '%s'",
+				 nb.opts.value_size_histogram ?
+				 nb.opts.value_size_histogram : "");
+		if (nb.value_size.min == 0 ||
+		    nb.value_size.max > (uint64_t)nb.opts.value_size)
+			nb_error("value sizes of '%s' are not in 1 - value_size",
+				 nb.opts.value_size_histogram);
+	} else if (nb.opts.value_size_min <= 0 ||
+		   nb_dist_init(&nb.value_size, nb.opts.value_size_dist,
+				nb.opts.value_size_min,
+				nb.opts.value_size) == -1) {
+		nb_error("bad value size distribution '%s' from %d to %d",
+			 nb.opts.value_size_dist, nb.opts.value_size_min,
+			 nb.opts.value_size);
+	}
+	int content = nb_value_content_match(nb.opts.value_content);
+	if (content == -1)
+		nb_error("bad value_content '%s'", nb.opts.value_content);
+	nb.value_content = content;
+	if (nb.opts.value_compression_ratio <= 0)
+		nb_error("bad value_compression_ratio");
+	/* validating scans */
+	if (!strcmp(nb.opts.scan_iterator, "ge"))
+		nb.scan_iterator = NB_SCAN_GE;
+	else if (!strcmp(nb.opts.scan_iterator, "gt"))
+		nb.scan_iterator = NB_SCAN_GT;
+	else if (!strcmp(nb.opts.scan_iterator, "le"))
+		nb.scan_iterator = NB_SCAN_LE;
+	else
+		nb_error("bad scan_iterator '%s'", nb.opts.scan_iterator);
+	if (nb.opts.scan_length_min < 1 ||
+	    nb_dist_init(&nb.scan_length, nb.opts.scan_length_dist,
+			 nb.opts.scan_length_min,
+			 nb.opts.scan_length_max) == -1)
+		nb_error("bad scan length distribution '%s' from %d to %d",
+			 nb.opts.scan_length_dist, nb.opts.scan_length_min,
+			 nb.opts.scan_length_max);
+	if (nb.opts.dist_scan && nb.db->scan == NULL)
+		nb_error("db driver '%s' doesn't support scans", nb.opts.db);
+	/* validating multi-key requests */
+	if (nb.opts.multi_key_count <= 0)
+		nb_error("bad multi_key_count");
+	if ((nb.opts.dist_multi_select && nb.db->multi_select == NULL) ||
+	    (nb.opts.dist_multi_replace && nb.db->multi_replace == NULL))
+		nb_error("db driver '%s' doesn't support multi-key requests",
+			 nb.opts.db);
+	if (nb.opts.dist_rmw && nb.db->rmw_write == NULL)
+		nb_error("db driver '%s' doesn't support read-modify-write",
+			 nb.opts.db);
 	/* validating threads distributions */
 	if (nb.opts.threads_policy == NB_THREADS_ATONCE &&
 	    nb.opts.threads_max <= 0)
@@ -143,6 +284,47 @@ static void nb_validate(void)
 	if (nb.opts.threads_policy == NB_THREADS_INTERVAL &&
 	    nb.opts.threads_start <= 0)
 		nb_error("bad threads_start count");
+	/* validating send batching */
+	if (nb.opts.send_batch_count <= 0)
+		nb_error("bad send_batch_count");
+	if (nb.opts.send_batch_size <= 0)
+		nb_error("bad send_batch_size");
+	if (nb.opts.max_inflight < 0)
+		nb_error("bad max_inflight");
+	/* validating connections */
+	if (nb.opts.connections <= 0)
+		nb_error("bad connections_per_worker count");
+	if (nb.opts.connections > 1 && nb.opts.request_batch_count)
+		nb_error("connections_per_worker requires request_batch_count 0");
+}
+
+/* The trace must be written for the key type of the run. */
+static void nb_init_trace(void)
+{
+	if (nb_trace_open(&nb.trace, nb.opts.trace_file) == -1)
+		nb_error("can't replay trace '%s'", nb.opts.trace_file);
+	struct nb_key key;
+	nb.key->init(&key, nb.key_dist, NULL);
+	size_t key_size = key.size;
+	nb.key->free(&key);
+	struct nb_trace_header *h = &nb.trace.header;
+	if (strcmp(h->key_type, nb.opts.key) != 0 || h->key_size != key_size)
+		nb_error("trace '%s' has %s keys of %" PRIu32 " bytes, "
+			 "key_type is %s of %zu bytes", nb.opts.trace_file,
+			 h->key_type, h->key_size, nb.opts.key, key_size);
+	if (h->value_size_max > (uint32_t)nb.opts.value_size)
+		nb_error("trace '%s' has values up to %" PRIu32 " bytes, "
+			 "more than value_size", nb.opts.trace_file,
+			 h->value_size_max);
+	for (int i = 0; i < NB_REQUEST_MAX; i++) {
+		if (!(nb.trace.types & (1u << i)))
+			continue;
+		if (nb.workload.reqs[i]._do == NULL ||
+		    (i == NB_RMW && nb.db->rmw_write == NULL))
+			nb_error("trace '%s' has %s requests, db driver '%s' "
+				 "doesn't support them", nb.opts.trace_file,
+				 nb_request_type_strs[i], nb.opts.db);
+	}
 }
 
 static void nb_init(void)
@@ -154,17 +336,59 @@ static void nb_init(void)
 		       nb.opts.threads_max :
 		       nb.opts.threads_start;
 	nb_statistics_init(&nb.stats, statmax);
+	/*
+	 * Let the bucket hold one millisecond of requests, so workers
+	 * paced by a millisecond timer don't lose tokens.
+	 */
+	if (nb.opts.total_rps)
+		nb_rate_init(&nb.rate, nb.opts.total_rps,
+			     nb.opts.total_rps / 1000);
 	/* initialize workload */
-	nb_workers_init(&nb.workers);
+	int multi_keys = nb.opts.dist_multi_select ||
+			 nb.opts.dist_multi_replace ?
+			 nb.opts.multi_key_count : 0;
+	nb_workers_init(&nb.workers, nb.opts.histogram_digits,
+			nb.opts.random_seed, multi_keys);
 	nb_workload_init(&nb.workload, nb.opts.request_count);
+	nb.key_count = nb.opts.request_count;
+	if (nb_workload_set_mix(&nb.workload, nb.opts.request_mix,
+				nb.opts.request_mix_schedule) == -1)
+		nb_error("bad request_mix '%s' or request_mix_schedule",
+			 nb.opts.request_mix);
 	nb_workload_add(&nb.workload, NB_REPLACE, nb.db->replace, nb.opts.dist_replace);
-	nb_workload_add(&nb.workload, NB_UPDATE, nb.db->update, nb.opts.dist_update);
+	/* A db without update gets replaces, they are the same for it. */
+	nb_workload_add(&nb.workload, NB_UPDATE,
+			nb.db->update ? nb.db->update : nb.db->replace,
+			nb.opts.dist_update);
 	nb_workload_add(&nb.workload, NB_SELECT, nb.db->select, nb.opts.dist_select);
 	nb_workload_add(&nb.workload, NB_DELETE, nb.db->del, nb.opts.dist_delete);
+	nb_workload_add(&nb.workload, NB_INSERT, nb.db->insert, nb.opts.dist_insert);
+	nb_workload_add(&nb.workload, NB_SCAN, nb.db->scan, nb.opts.dist_scan);
+	nb_workload_add(&nb.workload, NB_MULTI_SELECT, nb.db->multi_select,
+			nb.opts.dist_multi_select);
+	nb_workload_add(&nb.workload, NB_MULTI_REPLACE, nb.db->multi_replace,
+			nb.opts.dist_multi_replace);
+	nb_workload_add(&nb.workload, NB_RMW, nb.db->rmw_read, nb.opts.dist_rmw);
 	nb_workload_link(&nb.workload);
+	if (nb.opts.trace_file)
+		nb_init_trace();
+	/* latency histograms only of the request types that are sent */
+	uint32_t types = 0;
+	if (nb.opts.trace_file) {
+		types = nb.trace.types;
+	} else {
+		for (int i = 0; i < NB_REQUEST_MAX; i++) {
+			if (nb.workload.reqs[i].percent > 0)
+				types |= 1u << i;
+		}
+		/* A deleted key is reinserted by a replace. */
+		if (types & (1u << NB_DELETE))
+			types |= 1u << NB_REPLACE;
+	}
+	nb.workers.hist_types = types;
 	/* initialize key distribution */
 	if (nb.key_dist->init)
-		nb.key_dist->init(nb.opts.key_dist_iter);
+		nb.key_dist->init(&nb.opts);
 	/* initialize report interface */
 	if (nb.report->init)
 		nb.report->init();
@@ -176,6 +400,8 @@ static void nb_free(void)
 {
 	nb_statistics_free(&nb.stats);
 	nb_workers_free(&nb.workers);
+	nb_trace_close(&nb.trace);
+	nb_dist_free(&nb.value_size);
 	if (nb.report && nb.report->free)
 		nb.report->free();
 	nb_opt_free(&nb.opts);
@@ -185,6 +411,8 @@ static int nb_usage(char *binary)
 {
 	printf("NoSQL Benchmarking.\n\n");
 	printf("usage: %s [config_file_path]\n", binary);
+	printf("       %s --write-trace trace_file_path "
+	       "[config_file_path]\n", binary);
 	return 1;
 }
 
@@ -193,14 +421,24 @@ int main(int argc, char *argv[])
 	int rc = 0;
 	memset(&nb, 0, sizeof(struct nb));
 
+	nb.trace.fd = -1;
+
 	char *config = NB_DEFAULT_CONFIG;
-	if (argc == 2) {
-		if (!strcmp(argv[1], "-h") ||
-		    !strcmp(argv[1], "--help"))
+	char *trace = NULL;
+	int argi = 1;
+	if (argc > 1 && !strcmp(argv[1], "--write-trace")) {
+		if (argc < 3)
+			return nb_usage(argv[0]);
+		trace = argv[2];
+		argi = 3;
+	}
+	if (argc == argi + 1) {
+		if (!strcmp(argv[argi], "-h") ||
+		    !strcmp(argv[argi], "--help"))
 			return nb_usage(argv[0]);
-		config = argv[1];
+		config = argv[argi];
 	}
-	if (argc > 1 && argc != 2)
+	if (argc > argi + 1)
 		return nb_usage(argv[0]);
 
 	nb_opt_init(&nb.opts);
@@ -209,8 +447,17 @@ int main(int argc, char *argv[])
 		rc = 1;
 		goto done;
 	}
+	/* The trace is generated, a replayed one is ignored. */
+	if (trace) {
+		free(nb.opts.trace_file);
+		nb.opts.trace_file = NULL;
+	}
 
 	nb_init();
+	if (trace) {
+		rc = nb_trace_write(trace) == -1;
+		goto done;
+	}
 	if (nb.report->report_start)
 		nb.report->report_start();
 
@@ -34,6 +34,10 @@
 #include "nb_worker.h"
 #include "nb_opt.h"
 #include "nb_workload.h"
+#include "nb_rate.h"
+#include "nb_trace.h"
+#include "nb_dist.h"
+#include "nb_value.h"
 
 struct nb {
 	struct nb_options opts;
@@ -42,8 +46,20 @@ struct nb {
 	struct nb_db_if *db;
 	struct nb_report_if *report;
 	struct nb_workload workload;
+	/* Keys are [0, key_count), inserts append new ones. */
+	uint64_t key_count;
+	/* Count of distinct keys of the key type, 0 if unlimited. */
+	uint64_t key_id_limit;
 	struct nb_workers workers;
 	struct nb_statistics stats;
+	/* Shared by all workers if total_rps is set. */
+	struct nb_rate rate;
+	struct nb_dist value_size;
+	enum nb_value_content value_content;
+	enum nb_scan_iterator scan_iterator;
+	struct nb_dist scan_length;
+	/* Replayed instead of the workload if trace_file is set. */
+	struct nb_trace trace;
 	volatile int is_done;
 	int tick;
 };
@@ -58,4 +74,27 @@ static inline void nb_tick(void) {
 	nb.tick++;
 }
 
+/*
+ * Generate the key of a request, an insert takes a new key. Return
+ * -1 if inserts have taken all distinct keys of the key type, more
+ * ids would wrap into duplicates.
+ */
+static inline int
+nb_request_key(struct nb_key *key, enum nb_request_type type) {
+	if (type != NB_INSERT) {
+		nb.key->generate(key, __atomic_load_n(&nb.key_count,
+				 __ATOMIC_RELAXED));
+		return 0;
+	}
+	uint64_t id = __atomic_load_n(&nb.key_count, __ATOMIC_RELAXED);
+	do {
+		if (nb.key_id_limit != 0 && id >= nb.key_id_limit)
+			return -1;
+	} while (!__atomic_compare_exchange_n(&nb.key_count, &id, id + 1,
+					      1, __ATOMIC_RELAXED,
+					      __ATOMIC_RELAXED));
+	nb.key->generate_by_id(key, id);
+	return 0;
+}
+
 #endif
@@ -43,6 +43,14 @@ static inline void *nb_malloc(size_t size) {
 	return ptr;
 }
 
+static inline void *nb_malloc_aligned(size_t align, size_t size) {
+	void *ptr = NULL;
+	if (posix_memalign(&ptr, align, size) != 0)
+		ptr = NULL;
+	nb_oom(ptr);
+	return ptr;
+}
+
 static inline char *nb_strdup(char *sz) {
 	size_t len = strlen(sz);
 	void *ptr = nb_malloc(len + 1);
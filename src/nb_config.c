@@ -55,6 +55,7 @@ extern struct nb nb;
 enum nb_config_index_type {
 	NB_CONFIG_NONE,
 	NB_CONFIG_INT,
+	NB_CONFIG_INT64,
 	NB_CONFIG_STRING
 };
 
@@ -62,6 +63,7 @@ struct nb_config_index {
 	int token;
 	enum nb_config_index_type type;
 	int *vi;
+	int64_t *vl;
 	char **vs;
 };
 
@@ -85,6 +87,7 @@ enum {
 	NB_TK_CLIENT_CREATION_INCREMENT,
 	NB_TK_CLIENT_START,
 	NB_TK_CLIENT_MAX,
+	NB_TK_CONNECTIONS_PER_WORKER,
 	NB_TK_DB_DRIVER,
 	NB_TK_KEY_DISTRIBUTION,
 	NB_TK_KEY_DISTRIBUTION_ITER,
@@ -98,8 +101,46 @@ enum {
 	NB_TK_PORT,
 	NB_TK_BUF_RECV,
 	NB_TK_BUF_SEND,
+	NB_TK_SEND_BATCH_COUNT,
+	NB_TK_SEND_BATCH_SIZE,
+	NB_TK_MAX_INFLIGHT,
 	NB_TK_LATENCY_MEASURE_UNITS,
 	NB_TK_RPS,
+	NB_TK_IO_ENGINE,
+	NB_TK_RPS_ARRIVAL,
+	NB_TK_RPS_STEP,
+	NB_TK_RPS_STEP_INTERVAL,
+	NB_TK_RPS_PACING,
+	NB_TK_TOTAL_RPS,
+	NB_TK_HISTOGRAM_DIGITS,
+	NB_TK_TIME_SOURCE,
+	NB_TK_REQUEST_TIMEOUT,
+	NB_TK_RECONNECT_DELAY,
+	NB_TK_RECONNECT_MAX_DELAY,
+	NB_TK_KEY_PREFIX,
+	NB_TK_KEY_LENGTH,
+	NB_TK_RANDOM_SEED,
+	NB_TK_KEY_HOTSPOT_KEYS,
+	NB_TK_KEY_HOTSPOT_OPS,
+	NB_TK_REQUEST_MIX,
+	NB_TK_REQUEST_MIX_SCHEDULE,
+	NB_TK_TRACE_FILE,
+	NB_TK_INSERT,
+	NB_TK_WORKLOAD_PROFILE,
+	NB_TK_SCAN,
+	NB_TK_SCAN_ITERATOR,
+	NB_TK_SCAN_LENGTH_DISTRIBUTION,
+	NB_TK_SCAN_LENGTH_MIN,
+	NB_TK_SCAN_LENGTH_MAX,
+	NB_TK_MULTI_SELECT,
+	NB_TK_MULTI_REPLACE,
+	NB_TK_MULTI_KEY_COUNT,
+	NB_TK_RMW,
+	NB_TK_VALUE_SIZE_DISTRIBUTION,
+	NB_TK_VALUE_SIZE_MIN,
+	NB_TK_VALUE_SIZE_HISTOGRAM,
+	NB_TK_VALUE_CONTENT,
+	NB_TK_VALUE_COMPRESSION_RATIO,
 };
 
 #define NB_DECLARE_KEYWORD_DEF(NAME, ID) { NAME, sizeof(NAME) - 1, ID }
@@ -122,6 +163,7 @@ static struct tnt_lex_keyword nb_lex_keywords[] =
 	NB_DECLARE_KEYWORD("client_creation_increment", NB_TK_CLIENT_CREATION_INCREMENT),
 	NB_DECLARE_KEYWORD("client_start", NB_TK_CLIENT_START),
 	NB_DECLARE_KEYWORD("client_max", NB_TK_CLIENT_MAX),
+	NB_DECLARE_KEYWORD("connections_per_worker", NB_TK_CONNECTIONS_PER_WORKER),
 	NB_DECLARE_KEYWORD("db_driver", NB_TK_DB_DRIVER),
 	NB_DECLARE_KEYWORD("key_distribution", NB_TK_KEY_DISTRIBUTION),
 	NB_DECLARE_KEYWORD("key_distribution_iter", NB_TK_KEY_DISTRIBUTION_ITER),
@@ -135,24 +177,64 @@ static struct tnt_lex_keyword nb_lex_keywords[] =
 	NB_DECLARE_KEYWORD("port", NB_TK_PORT),
 	NB_DECLARE_KEYWORD("buf_recv", NB_TK_BUF_RECV),
 	NB_DECLARE_KEYWORD("buf_send", NB_TK_BUF_SEND),
+	NB_DECLARE_KEYWORD("send_batch_count", NB_TK_SEND_BATCH_COUNT),
+	NB_DECLARE_KEYWORD("send_batch_size", NB_TK_SEND_BATCH_SIZE),
+	NB_DECLARE_KEYWORD("max_inflight", NB_TK_MAX_INFLIGHT),
 	NB_DECLARE_KEYWORD("latency_measure_units", NB_TK_LATENCY_MEASURE_UNITS),
 	NB_DECLARE_KEYWORD("rps", NB_TK_RPS),
+	NB_DECLARE_KEYWORD("io_engine", NB_TK_IO_ENGINE),
+	NB_DECLARE_KEYWORD("rps_arrival", NB_TK_RPS_ARRIVAL),
+	NB_DECLARE_KEYWORD("rps_step", NB_TK_RPS_STEP),
+	NB_DECLARE_KEYWORD("rps_step_interval", NB_TK_RPS_STEP_INTERVAL),
+	NB_DECLARE_KEYWORD("rps_pacing", NB_TK_RPS_PACING),
+	NB_DECLARE_KEYWORD("total_rps", NB_TK_TOTAL_RPS),
+	NB_DECLARE_KEYWORD("histogram_digits", NB_TK_HISTOGRAM_DIGITS),
+	NB_DECLARE_KEYWORD("time_source", NB_TK_TIME_SOURCE),
+	NB_DECLARE_KEYWORD("request_timeout", NB_TK_REQUEST_TIMEOUT),
+	NB_DECLARE_KEYWORD("reconnect_delay", NB_TK_RECONNECT_DELAY),
+	NB_DECLARE_KEYWORD("reconnect_max_delay", NB_TK_RECONNECT_MAX_DELAY),
+	NB_DECLARE_KEYWORD("key_prefix", NB_TK_KEY_PREFIX),
+	NB_DECLARE_KEYWORD("key_length", NB_TK_KEY_LENGTH),
+	NB_DECLARE_KEYWORD("random_seed", NB_TK_RANDOM_SEED),
+	NB_DECLARE_KEYWORD("key_hotspot_keys", NB_TK_KEY_HOTSPOT_KEYS),
+	NB_DECLARE_KEYWORD("key_hotspot_ops", NB_TK_KEY_HOTSPOT_OPS),
+	NB_DECLARE_KEYWORD("request_mix", NB_TK_REQUEST_MIX),
+	NB_DECLARE_KEYWORD("request_mix_schedule", NB_TK_REQUEST_MIX_SCHEDULE),
+	NB_DECLARE_KEYWORD("trace_file", NB_TK_TRACE_FILE),
+	NB_DECLARE_KEYWORD("test_insert", NB_TK_INSERT),
+	NB_DECLARE_KEYWORD("workload_profile", NB_TK_WORKLOAD_PROFILE),
+	NB_DECLARE_KEYWORD("test_scan", NB_TK_SCAN),
+	NB_DECLARE_KEYWORD("scan_iterator", NB_TK_SCAN_ITERATOR),
+	NB_DECLARE_KEYWORD("scan_length_distribution", NB_TK_SCAN_LENGTH_DISTRIBUTION),
+	NB_DECLARE_KEYWORD("scan_length_min", NB_TK_SCAN_LENGTH_MIN),
+	NB_DECLARE_KEYWORD("scan_length_max", NB_TK_SCAN_LENGTH_MAX),
+	NB_DECLARE_KEYWORD("test_multi_select", NB_TK_MULTI_SELECT),
+	NB_DECLARE_KEYWORD("test_multi_replace", NB_TK_MULTI_REPLACE),
+	NB_DECLARE_KEYWORD("multi_key_count", NB_TK_MULTI_KEY_COUNT),
+	NB_DECLARE_KEYWORD("test_rmw", NB_TK_RMW),
+	NB_DECLARE_KEYWORD("value_size_distribution", NB_TK_VALUE_SIZE_DISTRIBUTION),
+	NB_DECLARE_KEYWORD("value_size_min", NB_TK_VALUE_SIZE_MIN),
+	NB_DECLARE_KEYWORD("value_size_histogram", NB_TK_VALUE_SIZE_HISTOGRAM),
+	NB_DECLARE_KEYWORD("value_content", NB_TK_VALUE_CONTENT),
+	NB_DECLARE_KEYWORD("value_compression_ratio", NB_TK_VALUE_COMPRESSION_RATIO),
 	NB_DECLARE_KEYWORD_END()
 };
 
-#define NB_DECLARE_OPT(ID, TYPE, I, S) { ID, TYPE, I, S }
+#define NB_DECLARE_OPT(ID, TYPE, I, L, S) { ID, TYPE, I, L, S }
 #define NB_DECLARE_OPT_INT(ID, VALUE) \
-	NB_DECLARE_OPT(ID, NB_CONFIG_INT, VALUE, NULL)
+	NB_DECLARE_OPT(ID, NB_CONFIG_INT, VALUE, NULL, NULL)
+#define NB_DECLARE_OPT_INT64(ID, VALUE) \
+	NB_DECLARE_OPT(ID, NB_CONFIG_INT64, NULL, VALUE, NULL)
 #define NB_DECLARE_OPT_STR(ID, VALUE) \
-	NB_DECLARE_OPT(ID, NB_CONFIG_STRING, NULL, VALUE)
+	NB_DECLARE_OPT(ID, NB_CONFIG_STRING, NULL, NULL, VALUE)
 #define NB_DECLARE_OPT_END() \
-	NB_DECLARE_OPT(0, NB_CONFIG_NONE, NULL, NULL)
+	NB_DECLARE_OPT(0, NB_CONFIG_NONE, NULL, NULL, NULL)
 
 struct nb_config_index nb_config_index[] =
 {
 	NB_DECLARE_OPT_STR(NB_TK_BENCHMARK, &nb.opts.benchmark_policy_name),
 	NB_DECLARE_OPT_INT(NB_TK_TIME_LIMIT, &nb.opts.time_limit),
-	NB_DECLARE_OPT_INT(NB_TK_REQUEST_COUNT, &nb.opts.request_count),
+	NB_DECLARE_OPT_INT64(NB_TK_REQUEST_COUNT, &nb.opts.request_count),
 	NB_DECLARE_OPT_INT(NB_TK_REQUEST_BATCH_COUNT, &nb.opts.request_batch_count),
 	NB_DECLARE_OPT_INT(NB_TK_REPORT_INTERVAL, &nb.opts.report_interval),
 	NB_DECLARE_OPT_STR(NB_TK_REPORT_TYPE, &nb.opts.report),
@@ -163,6 +245,7 @@ struct nb_config_index nb_config_index[] =
 	NB_DECLARE_OPT_INT(NB_TK_CLIENT_CREATION_INCREMENT, &nb.opts.threads_increment),
 	NB_DECLARE_OPT_INT(NB_TK_CLIENT_START, &nb.opts.threads_start),
 	NB_DECLARE_OPT_INT(NB_TK_CLIENT_MAX, &nb.opts.threads_max),
+	NB_DECLARE_OPT_INT(NB_TK_CONNECTIONS_PER_WORKER, &nb.opts.connections),
 	NB_DECLARE_OPT_STR(NB_TK_DB_DRIVER, &nb.opts.db),
 	NB_DECLARE_OPT_STR(NB_TK_KEY_DISTRIBUTION, &nb.opts.key_dist),
 	NB_DECLARE_OPT_INT(NB_TK_KEY_DISTRIBUTION_ITER, &nb.opts.key_dist_iter),
@@ -176,8 +259,46 @@ struct nb_config_index nb_config_index[] =
 	NB_DECLARE_OPT_INT(NB_TK_PORT, &nb.opts.port),
 	NB_DECLARE_OPT_INT(NB_TK_BUF_RECV, &nb.opts.buf_recv),
 	NB_DECLARE_OPT_INT(NB_TK_BUF_SEND, &nb.opts.buf_send),
+	NB_DECLARE_OPT_INT(NB_TK_SEND_BATCH_COUNT, &nb.opts.send_batch_count),
+	NB_DECLARE_OPT_INT(NB_TK_SEND_BATCH_SIZE, &nb.opts.send_batch_size),
+	NB_DECLARE_OPT_INT(NB_TK_MAX_INFLIGHT, &nb.opts.max_inflight),
 	NB_DECLARE_OPT_STR(NB_TK_LATENCY_MEASURE_UNITS, &nb.opts.latency_measure_units),
 	NB_DECLARE_OPT_INT(NB_TK_RPS, &nb.opts.rps),
+	NB_DECLARE_OPT_STR(NB_TK_IO_ENGINE, &nb.opts.io_engine),
+	NB_DECLARE_OPT_STR(NB_TK_RPS_ARRIVAL, &nb.opts.rps_arrival_name),
+	NB_DECLARE_OPT_INT(NB_TK_RPS_STEP, &nb.opts.rps_step),
+	NB_DECLARE_OPT_INT(NB_TK_RPS_STEP_INTERVAL, &nb.opts.rps_step_interval),
+	NB_DECLARE_OPT_STR(NB_TK_RPS_PACING, &nb.opts.rps_pacing),
+	NB_DECLARE_OPT_INT(NB_TK_TOTAL_RPS, &nb.opts.total_rps),
+	NB_DECLARE_OPT_INT(NB_TK_HISTOGRAM_DIGITS, &nb.opts.histogram_digits),
+	NB_DECLARE_OPT_STR(NB_TK_TIME_SOURCE, &nb.opts.time_source),
+	NB_DECLARE_OPT_INT(NB_TK_REQUEST_TIMEOUT, &nb.opts.request_timeout),
+	NB_DECLARE_OPT_INT(NB_TK_RECONNECT_DELAY, &nb.opts.reconnect_delay),
+	NB_DECLARE_OPT_INT(NB_TK_RECONNECT_MAX_DELAY, &nb.opts.reconnect_max_delay),
+	NB_DECLARE_OPT_STR(NB_TK_KEY_PREFIX, &nb.opts.key_prefix),
+	NB_DECLARE_OPT_INT(NB_TK_KEY_LENGTH, &nb.opts.key_length),
+	NB_DECLARE_OPT_INT(NB_TK_RANDOM_SEED, &nb.opts.random_seed),
+	NB_DECLARE_OPT_INT(NB_TK_KEY_HOTSPOT_KEYS, &nb.opts.key_hotspot_keys),
+	NB_DECLARE_OPT_INT(NB_TK_KEY_HOTSPOT_OPS, &nb.opts.key_hotspot_ops),
+	NB_DECLARE_OPT_STR(NB_TK_REQUEST_MIX, &nb.opts.request_mix),
+	NB_DECLARE_OPT_INT(NB_TK_REQUEST_MIX_SCHEDULE, &nb.opts.request_mix_schedule),
+	NB_DECLARE_OPT_STR(NB_TK_TRACE_FILE, &nb.opts.trace_file),
+	NB_DECLARE_OPT_INT(NB_TK_INSERT, &nb.opts.dist_insert),
+	NB_DECLARE_OPT_STR(NB_TK_WORKLOAD_PROFILE, &nb.opts.workload_profile),
+	NB_DECLARE_OPT_INT(NB_TK_SCAN, &nb.opts.dist_scan),
+	NB_DECLARE_OPT_STR(NB_TK_SCAN_ITERATOR, &nb.opts.scan_iterator),
+	NB_DECLARE_OPT_STR(NB_TK_SCAN_LENGTH_DISTRIBUTION, &nb.opts.scan_length_dist),
+	NB_DECLARE_OPT_INT(NB_TK_SCAN_LENGTH_MIN, &nb.opts.scan_length_min),
+	NB_DECLARE_OPT_INT(NB_TK_SCAN_LENGTH_MAX, &nb.opts.scan_length_max),
+	NB_DECLARE_OPT_INT(NB_TK_MULTI_SELECT, &nb.opts.dist_multi_select),
+	NB_DECLARE_OPT_INT(NB_TK_MULTI_REPLACE, &nb.opts.dist_multi_replace),
+	NB_DECLARE_OPT_INT(NB_TK_MULTI_KEY_COUNT, &nb.opts.multi_key_count),
+	NB_DECLARE_OPT_INT(NB_TK_RMW, &nb.opts.dist_rmw),
+	NB_DECLARE_OPT_STR(NB_TK_VALUE_SIZE_DISTRIBUTION, &nb.opts.value_size_dist),
+	NB_DECLARE_OPT_INT(NB_TK_VALUE_SIZE_MIN, &nb.opts.value_size_min),
+	NB_DECLARE_OPT_STR(NB_TK_VALUE_SIZE_HISTOGRAM, &nb.opts.value_size_histogram),
+	NB_DECLARE_OPT_STR(NB_TK_VALUE_CONTENT, &nb.opts.value_content),
+	NB_DECLARE_OPT_INT(NB_TK_VALUE_COMPRESSION_RATIO, &nb.opts.value_compression_ratio),
 	NB_DECLARE_OPT_END()
 };
 
@@ -221,6 +342,22 @@ static int nb_config_readint(struct nb_config *cfg, int *v) {
 	return 0;
 }
 
+/* Numbers which don't fit into 32 bits are lexed as NUM64. */
+static int nb_config_readint64(struct nb_config *cfg, int64_t *v) {
+	struct tnt_tk *tk = NULL;
+	int tk_ = tnt_lex(&cfg->lex, &tk);
+	if (tk_ == TNT_TK_ERROR)
+		return nb_config_error(cfg, NULL, "%s", cfg->lex.error);
+	if (tk_ == TNT_TK_NUM32)
+		*v = TNT_TK_I32(tk);
+	else if (tk_ == TNT_TK_NUM64)
+		*v = TNT_TK_I64(tk);
+	else
+		return nb_config_error(cfg, tk, "expected '%s'",
+				       tnt_lex_nameof(&cfg->lex, TNT_TK_NUM64));
+	return 0;
+}
+
 static int nb_config_readsz(struct nb_config *cfg, char **v) {
 	struct tnt_tk *tk = NULL;
 	if (nb_config_expect(cfg, TNT_TK_STRING, &tk) == -1)
@@ -243,6 +380,10 @@ static int nb_config_read(struct nb_config *cfg, struct tnt_tk *tk)
 			if (nb_config_readint(cfg, it->vi) == -1)
 				return -1;
 			break;
+		case NB_CONFIG_INT64:
+			if (nb_config_readint64(cfg, it->vl) == -1)
+				return -1;
+			break;
 		case NB_CONFIG_STRING:
 			if (nb_config_readsz(cfg, it->vs) == -1)
 				return -1;
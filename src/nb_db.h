@@ -37,30 +37,79 @@ struct nb_options;
 
 typedef int (*nb_db_reqf_t)(struct nb_db *db, struct nb_key *key);
 
+/* Answer to a request. */
+struct nb_db_reply {
+	uint64_t sync;
+	/* Count of tuples in the answer. */
+	uint32_t tuples;
+	/* Version of the tuple read, 0 if it is unknown. */
+	uint64_t version;
+};
+
+/* Direction of a scan from its key. */
+enum nb_scan_iterator {
+	NB_SCAN_GE,
+	NB_SCAN_GT,
+	NB_SCAN_LE
+};
+
 struct nb_db_if {
 	const char *name;
 	int (*init)(struct nb_db *db, size_t value_size);
 	void (*free)(struct nb_db *db);
 	int (*connect)(struct nb_db *db, struct nb_options *opts);
 	void (*close)(struct nb_db *db);
+	/*
+	 * Answers are identified by the sync of the request, the
+	 * reply is passed to reply_cb and filled by recv_from_buf
+	 * if it is not NULL.
+	 */
 	int (*recv)(struct nb_db *db, int count, int *missed,
-		    void (*latency_cb)(void *arg, uint64_t lat),
-		    void *lat_arg);
+		    void (*reply_cb)(void *arg, struct nb_db_reply *reply),
+		    void *reply_arg);
 	int (*get_fd)(struct nb_db *db);
 	int (*recv_from_buf)(char *buf, size_t size, size_t *off,
-			     uint64_t *latency);
+			     struct nb_db_reply *reply);
 	int (*msg_len)(const char *buf, size_t size);
 	void *(*get_buf)(struct nb_db *db, size_t *size);
 	nb_db_reqf_t insert;
 	nb_db_reqf_t replace;
+	/* May be NULL if it is equivalent to replace, which is sent instead. */
 	nb_db_reqf_t update;
 	nb_db_reqf_t del;
 	nb_db_reqf_t select;
+	/* Up to scan_limit tuples from the key, may be NULL. */
+	nb_db_reqf_t scan;
+	/*
+	 * Batches of multi_keys keys from the key array, answered
+	 * as one request, may be NULL.
+	 */
+	nb_db_reqf_t multi_select;
+	nb_db_reqf_t multi_replace;
+	/*
+	 * Read-modify-write: the read answers the version of the
+	 * tuple, the write stores the tuple only if it is still of
+	 * rmw_version and answers it. May be NULL.
+	 */
+	nb_db_reqf_t rmw_read;
+	nb_db_reqf_t rmw_write;
 };
 
 struct nb_db {
 	struct nb_db_if *dif;
 	void *priv;
+	/* Sync of the next request, the server returns it back. */
+	uint64_t sync;
+	/* Value of the next write, the size is at most of init. */
+	const char *value;
+	size_t value_size;
+	/* Parameters of the next scan. */
+	uint32_t scan_limit;
+	enum nb_scan_iterator scan_iterator;
+	/* Keys of a multi-key request. */
+	uint32_t multi_keys;
+	/* Version read by the read of a read-modify-write. */
+	uint64_t rmw_version;
 };
 
 extern struct nb_db_if *nb_dbs[];
@@ -83,7 +83,10 @@ struct db_leveldb {
 	struct leveldb_instance *instance;
 	char *value;
 	size_t value_size;
-	int sent; /* emulate nb recv api */
+	/* Answers of executed requests, emulate nb recv api. */
+	struct nb_db_reply *replies;
+	int sent;
+	int replies_size;
 };
 
 static int db_leveldb_instance_init(char *host, int port)
@@ -143,9 +146,11 @@ static int db_leveldb_init(struct nb_db *db, size_t value_size) {
 	memset(db->priv, 0, sizeof(struct db_leveldb));
 	struct db_leveldb *t = db->priv;
 	t->value_size = value_size;
+	db->value_size = value_size;
 	t->value = nb_malloc(t->value_size);
 	memset(t->value, '#', t->value_size - 1);
 	t->value[t->value_size - 1] = 0;
+	db->value = t->value;
 
 	return 0;
 }
@@ -156,6 +161,7 @@ static void db_leveldb_free(struct nb_db *db)
 
 	if (t->value)
 		free(t->value);
+	free(t->replies);
 	free(db->priv);
 	db->priv = NULL;
 }
@@ -213,6 +219,22 @@ static void db_leveldb_close(struct nb_db *db)
 	t->instance = NULL;
 }
 
+/* Requests are executed at once, the answer is kept for recv. */
+static void db_leveldb_done(struct nb_db *db, uint32_t tuples)
+{
+	struct db_leveldb *t = db->priv;
+	if (t->sent == t->replies_size) {
+		t->replies_size = t->replies_size ? t->replies_size * 2 : 16;
+		t->replies = nb_realloc((char *)t->replies,
+					sizeof(struct nb_db_reply) *
+					t->replies_size);
+	}
+	t->replies[t->sent].sync = db->sync;
+	t->replies[t->sent].tuples = tuples;
+	t->replies[t->sent].version = 0;
+	t->sent++;
+}
+
 static int db_leveldb_insert(struct nb_db *db, struct nb_key *key)
 {
 	struct db_leveldb *t = db->priv;
@@ -220,13 +242,13 @@ static int db_leveldb_insert(struct nb_db *db, struct nb_key *key)
 	char *err = NULL;
 
 	leveldb_put(t->instance->db, t->instance->woptions, key->data, key->size,
-		    t->value, t->value_size, &err);
+		    db->value, db->value_size, &err);
 	if (err != NULL) {
 		printf("leveldb_put() failed: %s\n", err);
 		return -1;
 	}
 
-	++t->sent;
+	db_leveldb_done(db, 1);
 	return 0;
 }
 
@@ -243,24 +265,25 @@ static int db_leveldb_replace(struct nb_db *db, struct nb_key *key)
 	}
 
 	leveldb_put(t->instance->db, t->instance->woptions, key->data, key->size,
-		    t->value, t->value_size, &err);
+		    db->value, db->value_size, &err);
 	if (err != NULL) {
 		printf("leveldb_put() failed: %s\n", err);
 		return -1;
 	}
 
-	++t->sent;
+	db_leveldb_done(db, 1);
 	return 0;
 }
 
-static int db_leveldb_update(struct nb_db *db, struct nb_key *key)
+/* Bytewise, as the default comparator of leveldb. */
+static int db_leveldb_keycmp(leveldb_iterator_t *it, struct nb_key *key)
 {
-	(void) db;
-	(void) key;
-
-	/* update is meaningless for leveldb, because it is equivalent to replace */
-	printf("leveldb update is not supported\n");
-	return -1;
+	size_t size;
+	const char *data = leveldb_iter_key(it, &size);
+	int rc = memcmp(data, key->data, size < key->size ? size : key->size);
+	if (rc != 0)
+		return rc;
+	return size < key->size ? -1 : size > key->size;
 }
 
 static int db_leveldb_delete(struct nb_db *db, struct nb_key *key)
@@ -276,7 +299,7 @@ static int db_leveldb_delete(struct nb_db *db, struct nb_key *key)
 		return -1;
 	}
 
-	++t->sent;
+	db_leveldb_done(db, 1);
 	return 0;
 }
 
@@ -300,21 +323,114 @@ static int db_leveldb_select(struct nb_db *db, struct nb_key *key)
 		return -1;
 	}
 
-	++t->sent;
+	db_leveldb_done(db, value != NULL);
+	return 0;
+}
+
+/* Visit up to scan_limit keys from the key in the scan direction. */
+static int db_leveldb_scan(struct nb_db *db, struct nb_key *key)
+{
+	struct db_leveldb *t = db->priv;
+	leveldb_iterator_t *it = leveldb_create_iterator(t->instance->db,
+							 t->instance->roptions);
+	leveldb_iter_seek(it, key->data, key->size);
+	if (db->scan_iterator == NB_SCAN_LE) {
+		/* Seek finds the first key >= the key. */
+		if (!leveldb_iter_valid(it))
+			leveldb_iter_seek_to_last(it);
+		else if (db_leveldb_keycmp(it, key) > 0)
+			leveldb_iter_prev(it);
+	} else if (db->scan_iterator == NB_SCAN_GT) {
+		if (leveldb_iter_valid(it) && db_leveldb_keycmp(it, key) == 0)
+			leveldb_iter_next(it);
+	}
+	uint32_t tuples = 0;
+	while (tuples < db->scan_limit && leveldb_iter_valid(it)) {
+		size_t value_size;
+		leveldb_iter_value(it, &value_size);
+		tuples++;
+		if (db->scan_iterator == NB_SCAN_LE)
+			leveldb_iter_prev(it);
+		else
+			leveldb_iter_next(it);
+	}
+	char *err = NULL;
+	leveldb_iter_get_error(it, &err);
+	leveldb_iter_destroy(it);
+	if (err != NULL) {
+		printf("leveldb iterator failed: %s\n", err);
+		leveldb_free(err);
+		return -1;
+	}
+
+	db_leveldb_done(db, tuples);
+	return 0;
+}
+
+/* The C api has no multi get, the keys are read one by one. */
+static int db_leveldb_multi_select(struct nb_db *db, struct nb_key *keys)
+{
+	struct db_leveldb *t = db->priv;
+	uint32_t tuples = 0;
+	for (uint32_t i = 0; i < db->multi_keys; i++) {
+		char *err = NULL;
+		size_t value_size;
+		char *value = leveldb_get(t->instance->db,
+					  t->instance->roptions,
+					  keys[i].data, keys[i].size,
+					  &value_size, &err);
+		if (err != NULL) {
+			printf("leveldb_get() failed: %s\n", err);
+			leveldb_free(err);
+			return -1;
+		}
+		if (value) {
+			tuples++;
+			leveldb_free(value);
+		}
+	}
+
+	db_leveldb_done(db, tuples);
+	return 0;
+}
+
+static int db_leveldb_multi_replace(struct nb_db *db, struct nb_key *keys)
+{
+	struct db_leveldb *t = db->priv;
+	leveldb_writebatch_t *batch = leveldb_writebatch_create();
+	for (uint32_t i = 0; i < db->multi_keys; i++)
+		leveldb_writebatch_put(batch, keys[i].data, keys[i].size,
+				       db->value, db->value_size);
+	char *err = NULL;
+	leveldb_write(t->instance->db, t->instance->woptions, batch, &err);
+	leveldb_writebatch_destroy(batch);
+	if (err != NULL) {
+		printf("leveldb_write() failed: %s\n", err);
+		leveldb_free(err);
+		return -1;
+	}
+
+	db_leveldb_done(db, db->multi_keys);
 	return 0;
 }
 
-static int db_leveldb_recv(struct nb_db *db, int count, int *missed)
+static int db_leveldb_recv(struct nb_db *db, int count, int *missed,
+			   void (*reply_cb)(void *arg,
+					    struct nb_db_reply *reply),
+			   void *reply_arg)
 {
 	struct db_leveldb *t = db->priv;
 
-	if (t->sent >= count) {
-		*missed = 0;
-		t->sent -= count;
-	} else {
-		*missed = count - t->sent;
-		t->sent = 0;
+	int n = t->sent < count ? t->sent : count;
+	if (missed)
+		*missed = count - n;
+	for (int i = 0; i < n; i++) {
+		if (reply_cb)
+			reply_cb(reply_arg, &t->replies[i]);
 	}
+	t->sent -= n;
+	memmove(t->replies, t->replies + n,
+		sizeof(struct nb_db_reply) * t->sent);
 
 	return 0;
 }
@@ -329,7 +445,10 @@ struct nb_db_if nb_db_leveldb =
 	.insert  = db_leveldb_insert,
 	.replace = db_leveldb_replace,
 	.del     = db_leveldb_delete,
-	.update  = db_leveldb_update,
+	/* update is meaningless for leveldb, it is equivalent to replace */
 	.select  = db_leveldb_select,
+	.scan    = db_leveldb_scan,
+	.multi_select  = db_leveldb_multi_select,
+	.multi_replace = db_leveldb_multi_replace,
 	.recv    = db_leveldb_recv
 };
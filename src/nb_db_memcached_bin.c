@@ -58,9 +58,11 @@ static int db_memcached_bin_init(struct nb_db *db, size_t value_size)
 	memset(db->priv, 0, sizeof(struct db_memcached_bin));
 	struct db_memcached_bin *t = db->priv;
 	t->value_size = value_size;
+	db->value_size = value_size;
 	t->value = nb_malloc(t->value_size);
 	memset(t->value, '#', t->value_size - 1);
 	t->value[t->value_size - 1] = 0;
+	db->value = t->value;
 	t->buf_size = 1024 + value_size;
 	t->buf = nb_malloc(t->buf_size);
 	return 0;
@@ -103,7 +105,8 @@ static int db_memcached_bin_insert(struct nb_db *db, struct nb_key *key)
 	struct db_memcached_bin *t = db->priv;
 	struct mc req;
 	mc_init   (&req, t->buf, t->buf_size, NULL, NULL);
-	mc_op_add (&req, key->data, key->size, t->value, t->value_size, 0, 0);
+	mc_op_add (&req, key->data, key->size, db->value, db->value_size, 0, 0);
+	mc_set_opaque(&req, db->sync);
 	uint32_t size = mc_used(&req);
 	assert(size <= t->buf_size);
 	int rc = tb_sessend(&t->s, t->buf, size);
@@ -117,7 +120,8 @@ static int db_memcached_bin_replace(struct nb_db *db, struct nb_key *key)
 	struct db_memcached_bin *t = db->priv;
 	struct mc req;
 	mc_init   (&req, t->buf, t->buf_size, NULL, NULL);
-	mc_op_set (&req, key->data, key->size, t->value, t->value_size, 0, 0);
+	mc_op_set (&req, key->data, key->size, db->value, db->value_size, 0, 0);
+	mc_set_opaque(&req, db->sync);
 	uint32_t size = mc_used(&req);
 	assert(size <= t->buf_size);
 	int rc = tb_sessend(&t->s, t->buf, size);
@@ -132,6 +136,7 @@ static int db_memcached_bin_delete(struct nb_db *db, struct nb_key *key)
 	struct mc req;
 	mc_init      (&req, t->buf, t->buf_size, NULL, NULL);
 	mc_op_delete (&req, key->data, key->size);
+	mc_set_opaque(&req, db->sync);
 	uint32_t size = mc_used(&req);
 	assert(size <= t->buf_size);
 	int rc = tb_sessend(&t->s, t->buf, size);
@@ -140,23 +145,30 @@ static int db_memcached_bin_delete(struct nb_db *db, struct nb_key *key)
 	return 0;
 }
 
-static int db_memcached_bin_update(struct nb_db *db, struct nb_key *key)
+static int db_memcached_bin_select(struct nb_db *db, struct nb_key *key)
 {
-	(void) db;
-	(void) key;
-
-	/* update is meaningless for memcached, because it is
-	 * equivalent to replace */
-	printf("memcached update is not supported\n");
-	return -1;
+	struct db_memcached_bin *t = db->priv;
+	struct mc req;
+	mc_init   (&req, t->buf, t->buf_size, NULL, NULL);
+	mc_op_get (&req, key->data, key->size);
+	mc_set_opaque(&req, db->sync);
+	uint32_t size = mc_used(&req);
+	assert(size <= t->buf_size);
+	int rc = tb_sessend(&t->s, t->buf, size);
+	if (rc == -1)
+		return -1;
+	return 0;
 }
 
-static int db_memcached_bin_select(struct nb_db *db, struct nb_key *key)
+/* The version of a value is its CAS, 0 stores it unconditionally. */
+static int db_memcached_bin_rmw_write(struct nb_db *db, struct nb_key *key)
 {
 	struct db_memcached_bin *t = db->priv;
 	struct mc req;
 	mc_init   (&req, t->buf, t->buf_size, NULL, NULL);
-	mc_op_get (&req, key->data, key->size);
+	mc_op_set (&req, key->data, key->size, db->value, db->value_size, 0, 0);
+	mc_set_opaque(&req, db->sync);
+	mc_set_cas(&req, db->rmw_version);
 	uint32_t size = mc_used(&req);
 	assert(size <= t->buf_size);
 	int rc = tb_sessend(&t->s, t->buf, size);
@@ -165,13 +177,73 @@ static int db_memcached_bin_select(struct nb_db *db, struct nb_key *key)
 	return 0;
 }
 
+/*
+ * A batch is sent as quiet requests and a NOOP: the server answers
+ * quiet gets only on hits and quiet sets only on errors, the NOOP
+ * answer ends the batch.
+ */
+static void db_memcached_bin_reserve(struct db_memcached_bin *t, size_t size)
+{
+	if (t->buf_size >= size)
+		return;
+	t->buf_size = size;
+	t->buf = nb_realloc(t->buf, t->buf_size);
+}
+
+static int db_memcached_bin_batch_send(struct nb_db *db, struct mc *req)
+{
+	struct db_memcached_bin *t = db->priv;
+	mc_op_get(req, "", 0);
+	req->hdr->cmd = MC_BIN_CMD_NOOP;
+	mc_set_opaque(req, db->sync);
+	uint32_t size = mc_used(req);
+	assert(size <= t->buf_size);
+	int rc = tb_sessend(&t->s, t->buf, size);
+	if (rc == -1)
+		return -1;
+	return 0;
+}
+
+static int db_memcached_bin_multi_select(struct nb_db *db, struct nb_key *keys)
+{
+	struct db_memcached_bin *t = db->priv;
+	db_memcached_bin_reserve(t, (sizeof(struct mc_hdr) + keys->size) *
+				 (db->multi_keys + 1));
+	struct mc req;
+	mc_init(&req, t->buf, t->buf_size, NULL, NULL);
+	for (uint32_t i = 0; i < db->multi_keys; i++) {
+		mc_op_get(&req, keys[i].data, keys[i].size);
+		req.hdr->cmd = MC_BIN_CMD_GETKQ;
+		mc_set_opaque(&req, db->sync);
+	}
+	return db_memcached_bin_batch_send(db, &req);
+}
+
+static int db_memcached_bin_multi_replace(struct nb_db *db, struct nb_key *keys)
+{
+	struct db_memcached_bin *t = db->priv;
+	db_memcached_bin_reserve(t, (sizeof(struct mc_hdr) +
+				 sizeof(struct mc_set_ext) + keys->size +
+				 db->value_size) * (db->multi_keys + 1));
+	struct mc req;
+	mc_init(&req, t->buf, t->buf_size, NULL, NULL);
+	for (uint32_t i = 0; i < db->multi_keys; i++) {
+		mc_op_set(&req, keys[i].data, keys[i].size, db->value,
+			  db->value_size, 0, 0);
+		req.hdr->cmd = MC_BIN_CMD_SETQ;
+		mc_set_opaque(&req, db->sync);
+	}
+	return db_memcached_bin_batch_send(db, &req);
+}
+
 static int db_memcached_bin_recv(struct nb_db *db, int count, int *missed,
-				 void (*latency_cb)(void *arg, uint64_t lat),
-				 void *lat_arg)
+				 void (*reply_cb)(void *arg,
+						  struct nb_db_reply *reply),
+				 void *reply_arg)
 {
-	(void)latency_cb;
-	(void)lat_arg;
 	struct db_memcached_bin *t = db->priv;
+	/* Hits of quiet gets of the batch being answered. */
+	uint32_t tuples = 0;
 	int rc = tb_sessync(&t->s);
 	if (rc == -1) {
 		printf("sync failed\n");
@@ -208,10 +280,33 @@ static int db_memcached_bin_recv(struct nb_db *db, int count, int *missed,
 		}
 get:
 		assert(p == end);
-		if (resp.hdr.cmd == MC_BIN_CMD_GET && resp.hdr.status)
-			*missed = *missed + 1;
-		else if (resp.hdr.cmd != MC_BIN_CMD_GET && resp.hdr.status)
+		if (resp.hdr.cmd == MC_BIN_CMD_GET && resp.hdr.status) {
+			if (missed)
+				*missed = *missed + 1;
+		} else if (resp.hdr.cmd == MC_BIN_CMD_SET &&
+			   resp.hdr.status <= 2) {
+			/* Not found or exists: a failed CAS, a conflict. */
+		} else if (resp.hdr.status) {
 			printf("server respond: %d\n", resp.hdr.status);
+		}
+		if (resp.hdr.cmd == MC_BIN_CMD_GETKQ) {
+			tuples++;
+			continue;
+		}
+		if (resp.hdr.cmd == MC_BIN_CMD_SETQ)
+			continue;
+		if (resp.hdr.cmd != MC_BIN_CMD_NOOP && !resp.hdr.status)
+			tuples++;
+		if (reply_cb) {
+			/* The opaque holds the low bits of the sync. */
+			struct nb_db_reply reply;
+			reply.sync = db->sync - (uint32_t)((uint32_t)db->sync -
+							  resp.hdr.opaque);
+			reply.tuples = tuples;
+			reply.version = resp.hdr.cas;
+			reply_cb(reply_arg, &reply);
+		}
+		tuples = 0;
 		count--;
 	}
 	return 0;
@@ -227,7 +322,11 @@ struct nb_db_if nb_db_memcached_bin =
 	.insert  = db_memcached_bin_insert,
 	.replace = db_memcached_bin_replace,
 	.del     = db_memcached_bin_delete,
-	.update  = db_memcached_bin_update,
+	/* update is meaningless for memcached, it is equivalent to replace */
 	.select  = db_memcached_bin_select,
+	.multi_select  = db_memcached_bin_multi_select,
+	.multi_replace = db_memcached_bin_multi_replace,
+	.rmw_read      = db_memcached_bin_select,
+	.rmw_write     = db_memcached_bin_rmw_write,
 	.recv    = db_memcached_bin_recv
 };
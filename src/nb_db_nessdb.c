@@ -65,7 +65,10 @@ struct db_nessdb {
 	struct nessdb_instance *instance;
 	char *value;
 	size_t value_size;
-	int sent; /* emulate nb recv api */
+	/* Answers of executed requests, emulate nb recv api. */
+	struct nb_db_reply *replies;
+	int sent;
+	int replies_size;
 };
 
 static int db_nessdb_instance_init(char *host, int port)
@@ -106,9 +109,11 @@ static int db_nessdb_init(struct nb_db *db, size_t value_size) {
 	memset(db->priv, 0, sizeof(struct db_nessdb));
 	struct db_nessdb *t = db->priv;
 	t->value_size = value_size;
+	db->value_size = value_size;
 	t->value = nb_malloc(t->value_size);
 	memset(t->value, '#', t->value_size - 1);
 	t->value[t->value_size - 1] = 0;
+	db->value = t->value;
 
 	return 0;
 }
@@ -119,6 +124,7 @@ static void db_nessdb_free(struct nb_db *db)
 
 	if (t->value)
 		free(t->value);
+	free(t->replies);
 	free(db->priv);
 	db->priv = NULL;
 }
@@ -161,18 +167,34 @@ static void db_nessdb_close(struct nb_db *db)
 	pthread_mutex_unlock(&instance_lock);
 }
 
+/* Requests are executed at once, the answer is kept for recv. */
+static void db_nessdb_done(struct nb_db *db, uint32_t tuples)
+{
+	struct db_nessdb *t = db->priv;
+	if (t->sent == t->replies_size) {
+		t->replies_size = t->replies_size ? t->replies_size * 2 : 16;
+		t->replies = nb_realloc((char *)t->replies,
+					sizeof(struct nb_db_reply) *
+					t->replies_size);
+	}
+	t->replies[t->sent].sync = db->sync;
+	t->replies[t->sent].tuples = tuples;
+	t->replies[t->sent].version = 0;
+	t->sent++;
+}
+
 static int db_nessdb_insert(struct nb_db *db, struct nb_key *key)
 {
 	struct db_nessdb *t = db->priv;
 
 	assert (key->size < UINT_MAX);
-	assert (t->value_size < UINT_MAX);
+	assert (db->value_size < UINT_MAX);
 
 	struct slice nkey, nval;
 	nkey.len = key->size;
 	nkey.data = key->data;
-	nval.len = t->value_size;
-	nval.data = t->value;
+	nval.len = db->value_size;
+	nval.data = (char *)db->value;
 
 	int count = db_add(t->instance->db, &nkey, &nval);
 	if (count != 1) {
@@ -180,7 +202,7 @@ static int db_nessdb_insert(struct nb_db *db, struct nb_key *key)
 		return -1;
 	}
 
-	++t->sent;
+	db_nessdb_done(db, 1);
 	return 0;
 }
 
@@ -189,13 +211,13 @@ static int db_nessdb_replace(struct nb_db *db, struct nb_key *key)
 	struct db_nessdb *t = db->priv;
 
 	assert (key->size < UINT_MAX);
-	assert (t->value_size < UINT_MAX);
+	assert (db->value_size < UINT_MAX);
 
 	struct slice nkey, nval;
 	nkey.len = key->size;
 	nkey.data = key->data;
-	nval.len = t->value_size;
-	nval.data = t->value;
+	nval.len = db->value_size;
+	nval.data = (char *)db->value;
 
 	/* db_remove(t->instance->db, &nkey); */
 	int count = db_add(t->instance->db, &nkey, &nval);
@@ -204,20 +226,10 @@ static int db_nessdb_replace(struct nb_db *db, struct nb_key *key)
 		return -1;
 	}
 
-	++t->sent;
+	db_nessdb_done(db, 1);
 	return 0;
 }
 
-static int db_nessdb_update(struct nb_db *db, struct nb_key *key)
-{
-	(void) db;
-	(void) key;
-
-	/* update is meaningless for nessdb, because it is equivalent to replace */
-	printf("nessdb update is not supported\n");
-	return -1;
-}
-
 static int db_nessdb_delete(struct nb_db *db, struct nb_key *key)
 {
 	struct db_nessdb *t = db->priv;
@@ -230,7 +242,7 @@ static int db_nessdb_delete(struct nb_db *db, struct nb_key *key)
 
 	db_remove(t->instance->db, &nkey);
 
-	++t->sent;
+	db_nessdb_done(db, 1);
 	return 0;
 }
 
@@ -244,27 +256,39 @@ static int db_nessdb_select(struct nb_db *db, struct nb_key *key)
 	nkey.len = key->size;
 	nkey.data = key->data;
 
+	/* A missing key is not an error, it is answered by no tuples. */
 	int count = db_get(t->instance->db, &nkey, &nval);
-	if (count != 1) {
+	if (count < 0) {
 		printf("db_get() failed: %d\n", count);
 		return -1;
 	}
 
 #if defined(HAVE_NESSDB_SST)
-	db_free_data(nval.data);
+	if (count == 1)
+		db_free_data(nval.data);
 #endif
 
-	++t->sent;
+	db_nessdb_done(db, count == 1);
 	return 0;
 }
 
-static int db_nessdb_recv(struct nb_db *db, int count, int *missed)
+static int db_nessdb_recv(struct nb_db *db, int count, int *missed,
+			  void (*reply_cb)(void *arg,
+					   struct nb_db_reply *reply),
+			  void *reply_arg)
 {
 	struct db_nessdb *t = db->priv;
 
-	assert (t->sent >= count);
-	*missed = 0;
-	t->sent -= count;
+	int n = t->sent < count ? t->sent : count;
+	if (missed)
+		*missed = count - n;
+	for (int i = 0; i < n; i++) {
+		if (reply_cb)
+			reply_cb(reply_arg, &t->replies[i]);
+	}
+	t->sent -= n;
+	memmove(t->replies, t->replies + n,
+		sizeof(struct nb_db_reply) * t->sent);
 
 	return 0;
 }
@@ -279,7 +303,7 @@ struct nb_db_if nb_db_nessdb =
 	.insert  = db_nessdb_insert,
 	.replace = db_nessdb_replace,
 	.del     = db_nessdb_delete,
-	.update  = db_nessdb_update,
+	/* update is meaningless for nessdb, it is equivalent to replace */
 	.select  = db_nessdb_select,
 	.recv    = db_nessdb_recv
 };
@@ -67,9 +67,11 @@ static int db_tarantool16_init(struct nb_db *db, size_t value_size) {
 	t->update_buf = tnt_update_container(NULL);
 	nb_oom(t->update_buf);
 	t->value_size = value_size;
+	db->value_size = value_size;
 	t->value = nb_malloc(t->value_size);
 	memset(t->value, '#', t->value_size - 1);
 	t->value[t->value_size - 1] = 0;
+	db->value = t->value;
 	return 0;
 }
 
@@ -140,8 +142,8 @@ static int db_tarantool16_insert(struct nb_db *db, struct nb_key *key)
 	tnt_object_reset(t->object);
 	tnt_object_add_array(t->object, 2);
 	encode_key(t->object, key);
-	tnt_object_add_str(t->object, t->value, t->value_size);
-	t->stream->reqid = nb.opts.get_time();
+	tnt_object_add_str(t->object, db->value, db->value_size);
+	t->stream->reqid = db->sync;
 
 	return tnt_insert(t->stream, 512, t->object);
 }
@@ -153,8 +155,8 @@ static int db_tarantool16_replace(struct nb_db *db, struct nb_key *key)
 	tnt_object_reset(t->object);
 	tnt_object_add_array(t->object, 2);
 	encode_key(t->object, key);
-	tnt_object_add_str(t->object, t->value, t->value_size);
-	t->stream->reqid = nb.opts.get_time();
+	tnt_object_add_str(t->object, db->value, db->value_size);
+	t->stream->reqid = db->sync;
 
 	return tnt_replace(t->stream, 512, t->object);
 }
@@ -166,7 +168,7 @@ static int db_tarantool16_delete(struct nb_db *db, struct nb_key *key)
 	tnt_object_reset(t->object);
 	tnt_object_add_array(t->object, 1);
 	encode_key(t->object, key);
-	t->stream->reqid = nb.opts.get_time();
+	t->stream->reqid = db->sync;
 
 	return tnt_delete(t->stream, 512, 0, t->object);
 }
@@ -176,7 +178,7 @@ static int db_tarantool16_update(struct nb_db *db, struct nb_key *key)
 	struct db_tarantool16 *t = db->priv;
 
 	tnt_object_reset(t->object);
-	tnt_object_add_str(t->object, t->value, t->value_size);
+	tnt_object_add_str(t->object, db->value, db->value_size);
 
 	tnt_update_container_reset(t->update_buf);
 	tnt_update_assign(t->update_buf, 2, t->object);
@@ -185,7 +187,7 @@ static int db_tarantool16_update(struct nb_db *db, struct nb_key *key)
 	tnt_object_reset(t->object);
 	tnt_object_add_array(t->object, 1);
 	encode_key(t->object, key);
-	t->stream->reqid = nb.opts.get_time();
+	t->stream->reqid = db->sync;
 
 	return tnt_update(t->stream, 512, 0, t->object, t->update_buf);
 }
@@ -197,11 +199,110 @@ static int db_tarantool16_select(struct nb_db *db, struct nb_key *key)
 	tnt_object_reset(t->object);
 	tnt_object_add_array(t->object, 1);
 	encode_key(t->object, key);
-	t->stream->reqid = nb.opts.get_time();
+	t->stream->reqid = db->sync;
 
 	return tnt_select(t->stream, 512, 0, 1024, 0, 0, t->object);
 }
 
+static const uint8_t db_tarantool16_iterators[] = {
+	[NB_SCAN_GE] = TNT_ITER_GE,
+	[NB_SCAN_GT] = TNT_ITER_GT,
+	[NB_SCAN_LE] = TNT_ITER_LE
+};
+
+static int db_tarantool16_scan(struct nb_db *db, struct nb_key *key)
+{
+	struct db_tarantool16 *t = db->priv;
+
+	tnt_object_reset(t->object);
+	tnt_object_add_array(t->object, 1);
+	encode_key(t->object, key);
+	t->stream->reqid = db->sync;
+
+	return tnt_select(t->stream, 512, 0, db->scan_limit, 0,
+			  db_tarantool16_iterators[db->scan_iterator],
+			  t->object);
+}
+
+/*
+ * Multi-key requests call the stored procedures of README.md, the
+ * argument is the array of keys or tuples.
+ */
+#define DB_TARANTOOL16_MULTI_GET "nb_multi_get"
+#define DB_TARANTOOL16_MULTI_REPLACE "nb_multi_replace"
+#define DB_TARANTOOL16_CAS "nb_cas"
+
+static int db_tarantool16_multi_select(struct nb_db *db, struct nb_key *keys)
+{
+	struct db_tarantool16 *t = db->priv;
+
+	tnt_object_reset(t->object);
+	tnt_object_add_array(t->object, 1);
+	tnt_object_add_array(t->object, db->multi_keys);
+	for (uint32_t i = 0; i < db->multi_keys; i++)
+		encode_key(t->object, &keys[i]);
+	t->stream->reqid = db->sync;
+
+	return tnt_call(t->stream, DB_TARANTOOL16_MULTI_GET,
+			strlen(DB_TARANTOOL16_MULTI_GET), t->object);
+}
+
+static int db_tarantool16_multi_replace(struct nb_db *db, struct nb_key *keys)
+{
+	struct db_tarantool16 *t = db->priv;
+
+	tnt_object_reset(t->object);
+	tnt_object_add_array(t->object, 1);
+	tnt_object_add_array(t->object, db->multi_keys);
+	for (uint32_t i = 0; i < db->multi_keys; i++) {
+		tnt_object_add_array(t->object, 2);
+		encode_key(t->object, &keys[i]);
+		tnt_object_add_str(t->object, db->value, db->value_size);
+	}
+	t->stream->reqid = db->sync;
+
+	return tnt_call(t->stream, DB_TARANTOOL16_MULTI_REPLACE,
+			strlen(DB_TARANTOOL16_MULTI_REPLACE), t->object);
+}
+
+/*
+ * The version of a tuple is its third field, nb_cas replaces the
+ * tuple by {key, value, version + 1} if it is of the version and
+ * returns the new tuple.
+ */
+static int db_tarantool16_rmw_write(struct nb_db *db, struct nb_key *key)
+{
+	struct db_tarantool16 *t = db->priv;
+
+	tnt_object_reset(t->object);
+	tnt_object_add_array(t->object, 3);
+	encode_key(t->object, key);
+	tnt_object_add_int(t->object, db->rmw_version);
+	tnt_object_add_str(t->object, db->value, db->value_size);
+	t->stream->reqid = db->sync;
+
+	return tnt_call(t->stream, DB_TARANTOOL16_CAS,
+			strlen(DB_TARANTOOL16_CAS), t->object);
+}
+
+/* The body of an answer is an array of tuples. */
+static void db_tarantool16_reply(struct tnt_reply *r, struct nb_db_reply *reply)
+{
+	reply->sync = r->sync;
+	reply->tuples = 0;
+	reply->version = 0;
+	const char *data = r->data;
+	if (data != NULL && data < r->data_end && mp_typeof(*data) == MP_ARRAY)
+		reply->tuples = mp_decode_array(&data);
+	if (reply->tuples == 0 || mp_typeof(*data) != MP_ARRAY ||
+	    mp_decode_array(&data) < 3)
+		return;
+	mp_next(&data);
+	mp_next(&data);
+	if (mp_typeof(*data) == MP_UINT)
+		reply->version = mp_decode_uint(&data);
+}
+
 static int db_tarantool16_msg_len(const char *buf, size_t size)
 {
 	if (size < 5) {
@@ -214,24 +315,25 @@ static int db_tarantool16_msg_len(const char *buf, size_t size)
 }
 
 static int db_tarantool16_recv_from_buf(char *buf, size_t size, size_t *off,
-					uint64_t *latency)
+					struct nb_db_reply *reply)
 {
-	struct tnt_reply reply;
-	int rc = tnt_reply(&reply, buf, size, off);
-	if (reply.code != 0) {
-		printf("server responded: %d, %-.*s\n", (int)reply.code,
-		       (int)(reply.error_end - reply.error), reply.error);
+	struct tnt_reply r;
+	int rc = tnt_reply(&r, buf, size, off);
+	if (r.code != 0) {
+		printf("server responded: %d, %-.*s\n", (int)r.code,
+		       (int)(r.error_end - r.error), r.error);
 	}
 	if (rc)
 		return rc;
-	if (latency)
-		*latency = nb.opts.get_time() - reply.sync;
+	if (reply)
+		db_tarantool16_reply(&r, reply);
 	return 0;
 }
 
 static int db_tarantool16_recv(struct nb_db *db, int count, int *missed,
-			       void (*latency_cb)(void *arg, uint64_t lat),
-			       void *lat_arg)
+			       void (*reply_cb)(void *arg,
+						struct nb_db_reply *reply),
+			       void *reply_arg)
 {
 	(void)missed;
 	struct db_tarantool16 *t = db->priv;
@@ -247,8 +349,11 @@ static int db_tarantool16_recv(struct nb_db *db, int count, int *missed,
 			printf("server responded: %d, %-.*s\n", (int)r->code,
 			       (int)(r->error_end - r->error), r->error);
 		}
-		if (latency_cb)
-			latency_cb(lat_arg, nb.opts.get_time() - r->sync);
+		if (reply_cb) {
+			struct nb_db_reply reply;
+			db_tarantool16_reply(r, &reply);
+			reply_cb(reply_arg, &reply);
+		}
 	}
 	if (it.status == TNT_ITER_FAIL) {
 		if (TNT_SNET_CAST(t->stream)->error) {
@@ -282,6 +387,11 @@ struct nb_db_if nb_db_tarantool16 =
 	.del      = db_tarantool16_delete,
 	.update   = db_tarantool16_update,
 	.select   = db_tarantool16_select,
+	.scan     = db_tarantool16_scan,
+	.multi_select  = db_tarantool16_multi_select,
+	.multi_replace = db_tarantool16_multi_replace,
+	.rmw_read      = db_tarantool16_select,
+	.rmw_write     = db_tarantool16_rmw_write,
 	.recv     = db_tarantool16_recv,
 	.get_fd   = db_tarantool16_get_fd,
 	.recv_from_buf = db_tarantool16_recv_from_buf,
@@ -0,0 +1,155 @@
+
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include <math.h>
+
+#include "nb_alloc.h"
+#include "nb_dist.h"
+
+/*
+ * Sum of 1 / i^theta for i in [1, n]. The first million terms are
+ * summed, the rest is approximated by Euler-Maclaurin formula, so
+ * the init is fast for any n.
+ */
+static double nb_zeta(uint64_t n, double theta)
+{
+	uint64_t head = n < 1000000 ? n : 1000000;
+	double sum = 0;
+	for (uint64_t i = 1; i <= head; i++)
+		sum += pow((double)i, -theta);
+	if (n > head) {
+		double a = head, b = n;
+		sum += (pow(b, 1 - theta) - pow(a, 1 - theta)) / (1 - theta) +
+		       (pow(b, -theta) - pow(a, -theta)) / 2 -
+		       theta * (pow(b, -theta - 1) - pow(a, -theta - 1)) / 12;
+	}
+	return sum;
+}
+
+void nb_zipf_init(struct nb_zipf *zipf, uint64_t n, double theta)
+{
+	zipf->n = n > 0 ? n : 1;
+	zipf->theta = theta;
+	zipf->alpha = 1.0 / (1.0 - theta);
+	zipf->zetan = nb_zeta(zipf->n, theta);
+	double zeta2 = nb_zeta(2, theta);
+	zipf->eta = (1 - pow(2.0 / zipf->n, 1 - theta)) /
+		    (1 - zeta2 / zipf->zetan);
+	zipf->half_pow_theta = pow(0.5, theta);
+}
+
+int nb_dist_init(struct nb_dist *dist, const char *name, uint64_t min,
+		 uint64_t max)
+{
+	if (min > max)
+		return -1;
+	if (!strcmp(name, "fixed"))
+		dist->type = NB_DIST_FIXED;
+	else if (!strcmp(name, "uniform"))
+		dist->type = NB_DIST_UNIFORM;
+	else if (!strcmp(name, "zipfian"))
+		dist->type = NB_DIST_ZIPFIAN;
+	else
+		return -1;
+	dist->min = min;
+	dist->max = max;
+	dist->values = NULL;
+	dist->cdf = NULL;
+	dist->count = 0;
+	if (dist->type == NB_DIST_ZIPFIAN)
+		nb_zipf_init(&dist->zipf, max - min + 1, NB_ZIPF_THETA);
+	return 0;
+}
+
+int nb_dist_load(struct nb_dist *dist, const char *path)
+{
+	FILE *f = fopen(path, "r");
+	if (f == NULL)
+		return -1;
+	memset(dist, 0, sizeof(*dist));
+	dist->type = NB_DIST_HISTOGRAM;
+	size_t size = 0;
+	double sum = 0;
+	char line[256];
+	while (fgets(line, sizeof(line), f)) {
+		char *p = line;
+		while (isspace((unsigned char)*p))
+			p++;
+		if (*p == '#' || *p == '\0')
+			continue;
+		unsigned long long value;
+		double weight;
+		if (sscanf(p, "%llu %lf", &value, &weight) != 2 || weight < 0)
+			goto error;
+		if (dist->count == size) {
+			size = size ? size * 2 : 64;
+			dist->values = (uint64_t *)nb_realloc(
+				(char *)dist->values, sizeof(uint64_t) * size);
+			dist->cdf = (double *)nb_realloc(
+				(char *)dist->cdf, sizeof(double) * size);
+		}
+		sum += weight;
+		dist->values[dist->count] = value;
+		dist->cdf[dist->count] = sum;
+		dist->count++;
+	}
+	if (ferror(f) || sum <= 0)
+		goto error;
+	fclose(f);
+	dist->min = dist->values[0];
+	dist->max = dist->values[0];
+	for (size_t i = 0; i < dist->count; i++) {
+		dist->cdf[i] /= sum;
+		if (dist->values[i] < dist->min)
+			dist->min = dist->values[i];
+		if (dist->values[i] > dist->max)
+			dist->max = dist->values[i];
+	}
+	return 0;
+error:
+	fclose(f);
+	nb_dist_free(dist);
+	return -1;
+}
+
+void nb_dist_free(struct nb_dist *dist)
+{
+	free(dist->values);
+	free(dist->cdf);
+	dist->values = NULL;
+	dist->cdf = NULL;
+	dist->count = 0;
+}
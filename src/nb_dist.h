@@ -0,0 +1,137 @@
+#ifndef NB_DIST_H_INCLUDED
+#define NB_DIST_H_INCLUDED
+
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+#include "nb_rand.h"
+
+/*
+ * Zipfian distribution of YCSB (Gray et al., "Quickly generating
+ * billion-record synthetic databases"): i in [0, n) is drawn with
+ * probability proportional to 1 / (i + 1)^theta. The constants
+ * depend on n only and are computed at init, a sample costs one
+ * pow().
+ */
+#define NB_ZIPF_THETA 0.99
+
+struct nb_zipf {
+	uint64_t n;
+	double theta;
+	double alpha;
+	double zetan;
+	double eta;
+	double half_pow_theta;
+};
+
+void nb_zipf_init(struct nb_zipf *zipf, uint64_t n, double theta);
+
+static inline uint64_t
+nb_zipf_next(const struct nb_zipf *zipf, struct nb_rand *rand)
+{
+	double u = nb_rand_double(rand);
+	double uz = u * zipf->zetan;
+	if (uz < 1.0 || zipf->n < 2)
+		return 0;
+	if (uz < 1.0 + zipf->half_pow_theta)
+		return 1;
+	uint64_t v = zipf->n * pow(zipf->eta * u - zipf->eta + 1,
+				   zipf->alpha);
+	return v < zipf->n ? v : zipf->n - 1;
+}
+
+enum nb_dist_type {
+	/* Always max. */
+	NB_DIST_FIXED,
+	NB_DIST_UNIFORM,
+	/* min is the most frequent. */
+	NB_DIST_ZIPFIAN,
+	/* Values of a file with their weights. */
+	NB_DIST_HISTOGRAM
+};
+
+/* Distribution of a size in [min, max], e.g. of a scan length. */
+struct nb_dist {
+	enum nb_dist_type type;
+	uint64_t min;
+	uint64_t max;
+	struct nb_zipf zipf;
+	/* Values of a histogram and their cumulative probabilities. */
+	uint64_t *values;
+	double *cdf;
+	size_t count;
+};
+
+/*
+ * Init the distribution by its name: fixed, uniform or zipfian.
+ * Return -1 if the name is unknown or min > max.
+ */
+int nb_dist_init(struct nb_dist *dist, const char *name, uint64_t min,
+		 uint64_t max);
+
+/*
+ * Init the histogram of a file of "value weight" lines, '#' starts
+ * a comment. Return -1 if the file can't be read or is malformed.
+ */
+int nb_dist_load(struct nb_dist *dist, const char *path);
+
+void nb_dist_free(struct nb_dist *dist);
+
+static inline uint64_t
+nb_dist_next(const struct nb_dist *dist, struct nb_rand *rand)
+{
+	switch (dist->type) {
+	case NB_DIST_UNIFORM:
+		return dist->min +
+		       nb_rand_range64(rand, dist->max - dist->min + 1);
+	case NB_DIST_ZIPFIAN:
+		return dist->min + nb_zipf_next(&dist->zipf, rand);
+	case NB_DIST_HISTOGRAM: {
+		/* The first value of a cumulative probability above u. */
+		double u = nb_rand_double(rand);
+		size_t lo = 0, hi = dist->count - 1;
+		while (lo < hi) {
+			size_t mid = lo + (hi - lo) / 2;
+			if (dist->cdf[mid] > u)
+				hi = mid;
+			else
+				lo = mid + 1;
+		}
+		return dist->values[lo];
+	}
+	default:
+		return dist->max;
+	}
+}
+
+#endif
@@ -38,6 +38,7 @@
 
 #include <unistd.h>
 #include <signal.h>
+#include <time.h>
 
 #include "nosqlbench.h"
 #include "async_io.h"
@@ -50,7 +51,8 @@ extern volatile sig_atomic_t nb_signaled;
 struct io_user_data {
 	struct nb_worker *worker;
 	struct nb_request *request;
-	enum nb_request_type prev_type;
+	/* Start of the open-loop schedule by get_time(). */
+	uint64_t sched_start;
 };
 
 static void
@@ -61,11 +63,145 @@ nb_worker_init(void) {
 	pthread_sigmask(SIG_BLOCK, &set, NULL);
 }
 
-static int io_write_impl(struct io_user_data *ud)
+/* Request timeout in nanoseconds. */
+static inline uint64_t io_timeout(void)
+{
+	return (uint64_t)nb.opts.request_timeout * 1000000;
+}
+
+static void nb_dependent_push(struct nb_worker_conn *conn, uint64_t sync,
+			      uint64_t version)
+{
+	if (conn->dependents_count == conn->dependents_size) {
+		size_t size = conn->dependents_size ?
+			      conn->dependents_size * 2 : 16;
+		struct nb_dependent *d = nb_malloc(sizeof(*d) * size);
+		for (size_t i = 0; i < conn->dependents_count; i++)
+			d[i] = conn->dependents[(conn->dependents_head + i) %
+						conn->dependents_size];
+		free(conn->dependents);
+		conn->dependents = d;
+		conn->dependents_head = 0;
+		conn->dependents_size = size;
+	}
+	struct nb_dependent *d =
+		&conn->dependents[(conn->dependents_head +
+				   conn->dependents_count) %
+				  conn->dependents_size];
+	d->sync = sync;
+	d->version = version;
+	conn->dependents_count++;
+}
+
+/*
+ * Forget the request that the driver failed to make, so its
+ * in-flight entry doesn't leak. The timeout wheel skips the entries
+ * that are gone. Return 1 to stop the worker, the failure is of the
+ * driver, not of the one request.
+ */
+static int io_request_failed(struct nb_worker_conn *conn)
+{
+	struct nb_inflight_entry *e =
+		nb_inflight_find(&conn->inflight, conn->db.sync);
+	if (e != NULL)
+		nb_inflight_remove(&conn->inflight, e);
+	printf("db driver '%s' failed to make a request\n", nb.db->name);
+	return 1;
+}
+
+/*
+ * Send the write of an answered read-modify-write, return -1 if
+ * there is none, 1 if it failed. The request keeps the send time of
+ * the read, so its latency is of both of them, its timeout is
+ * counted from now.
+ */
+static int io_write_dependent(struct nb_worker *worker,
+			      struct nb_worker_conn *conn, uint64_t now)
+{
+	while (conn->dependents_count != 0) {
+		struct nb_dependent d = conn->dependents[conn->dependents_head];
+		conn->dependents_head = (conn->dependents_head + 1) %
+					conn->dependents_size;
+		conn->dependents_count--;
+		struct nb_inflight_entry *e =
+			nb_inflight_find(&conn->inflight, d.sync);
+		/* Timed out. */
+		if (e == NULL)
+			continue;
+		uint64_t time = e->time;
+		memcpy(conn->keyv.data, nb_inflight_key(&conn->inflight, e),
+		       conn->keyv.size);
+		nb_inflight_remove(&conn->inflight, e);
+		conn->db.sync = nb_inflight_add(&conn->inflight, time, now,
+						NB_RMW, conn->keyv.data,
+						conn->keyv.size);
+		nb_inflight_find(&conn->inflight, conn->db.sync)->stage = 1;
+		if (nb.opts.request_timeout)
+			nb_wheel_add(&conn->wheel, now + io_timeout(),
+				     conn->db.sync);
+		conn->db.rmw_version = d.version;
+		nb_value_next(&worker->values, &worker->rand, &conn->db.value,
+			      &conn->db.value_size);
+		if (nb.db->rmw_write(&conn->db, &conn->keyv) == -1)
+			return io_request_failed(conn);
+		worker->workload.requested++;
+		nb_history_add(&worker->history, RT_WRITE);
+		return 0;
+	}
+	return -1;
+}
+
+/*
+ * Send the next request of the trace shard of the worker. Keys are
+ * sent right from the mapping, deleted keys are reinserted by the
+ * trace itself.
+ */
+static int io_replay(struct nb_worker *worker, struct nb_worker_conn *conn,
+		     uint64_t time, uint64_t now)
+{
+	int rc = io_write_dependent(worker, conn, now);
+	if (rc != -1)
+		return rc;
+	const struct nb_trace_record *rec = nb_trace_next(&worker->trace);
+	if (rec->type >= NB_REQUEST_MAX)
+		return 1;
+	struct nb_request *request = &worker->workload.reqs[rec->type];
+	struct nb_key key = {(char *)rec->key, worker->trace.key_size,
+			     NULL, NULL};
+	conn->db.sync = nb_inflight_add(&conn->inflight, time, now, rec->type,
+					key.data, key.size);
+	if (nb.opts.request_timeout)
+		nb_wheel_add(&conn->wheel, now + io_timeout(), conn->db.sync);
+	if (rec->type == NB_SCAN) {
+		conn->db.scan_limit = rec->size;
+		conn->db.scan_iterator = nb.scan_iterator;
+	} else {
+		/* A prefix of the head, one value of the trace maximum. */
+		conn->db.value = worker->values.data;
+		conn->db.value_size = rec->size;
+	}
+	if (request->_do(&conn->db, &key) == -1)
+		return io_request_failed(conn);
+	request->requested++;
+	worker->workload.requested++;
+	nb_history_add(&worker->history, rec->type == NB_SELECT ||
+		       rec->type == NB_SCAN || rec->type == NB_RMW ?
+		       RT_READ : RT_WRITE);
+	return 0;
+}
+
+/*
+ * Send the next request of the workload, the latency is measured
+ * from the time and the timeout from now, the real send time.
+ */
+static int io_write_impl(struct io_user_data *ud, struct nb_worker_conn *conn,
+			 uint64_t time, uint64_t now)
 {
 	struct nb_worker *worker = ud->worker;
 	if (nb.is_done)
 		return 1;
+	if (worker->trace.map != NULL)
+		return io_replay(worker, conn, time, now);
 	/**
 	 * The request can be unset if it is first call of io_write
 	 * or if all requests already sent and need to rewind list of
@@ -76,23 +212,65 @@ static int io_write_impl(struct io_user_data *ud)
 		ud->request = nb_workload_fetch(&worker->workload);
 		if (ud->request == NULL)
 			return 1;
-	} else {
-		/* If the previous request deleted a tuple then reinsert it. */
-		if (ud->prev_type == NB_DELETE) {
-			nb.db->replace(&worker->db, &worker->keyv);
-			worker->workload.requested++;
-			ud->prev_type = NB_INSERT;
-			nb_history_add(&worker->history, RT_WRITE);
-			return 0;
-		}
 	}
-	worker->key->generate(&worker->keyv, worker->workload.count);
-	ud->request->_do(&worker->db, &worker->keyv);
+	/*
+	 * If the previous request of this connection deleted a tuple
+	 * then reinsert it.
+	 */
+	if (conn->prev_type == NB_DELETE) {
+		conn->db.sync = nb_inflight_add(&conn->inflight, time, now,
+						NB_REPLACE, conn->keyv.data,
+						conn->keyv.size);
+		if (nb.opts.request_timeout)
+			nb_wheel_add(&conn->wheel, now + io_timeout(),
+				     conn->db.sync);
+		nb_value_next(&worker->values, &worker->rand, &conn->db.value,
+			      &conn->db.value_size);
+		if (nb.db->replace(&conn->db, &conn->keyv) == -1)
+			return io_request_failed(conn);
+		worker->workload.requested++;
+		conn->prev_type = NB_INSERT;
+		nb_history_add(&worker->history, RT_WRITE);
+		return 0;
+	}
+	int rc = io_write_dependent(worker, conn, now);
+	if (rc != -1)
+		return rc;
+	/* A multi-key request is registered by its first key. */
+	struct nb_key *key = &conn->keyv;
+	if (ud->request->type == NB_MULTI_SELECT ||
+	    ud->request->type == NB_MULTI_REPLACE) {
+		key = worker->multi_keys;
+		for (uint32_t i = 0; i < conn->db.multi_keys; i++)
+			nb_request_key(&key[i], ud->request->type);
+	} else if (nb_request_key(key, ud->request->type) == -1) {
+		printf("inserts exceed %" PRIu64 " distinct keys of key "
+		       "type '%s'\n", nb.key_id_limit, nb.opts.key);
+		return 1;
+	}
+	conn->db.sync = nb_inflight_add(&conn->inflight, time, now,
+					ud->request->type, key->data,
+					key->size);
+	if (nb.opts.request_timeout)
+		nb_wheel_add(&conn->wheel, now + io_timeout(), conn->db.sync);
+	int is_read = ud->request->type == NB_SELECT ||
+		      ud->request->type == NB_SCAN ||
+		      ud->request->type == NB_MULTI_SELECT ||
+		      ud->request->type == NB_RMW;
+	if (ud->request->type == NB_SCAN) {
+		conn->db.scan_limit = nb_dist_next(&nb.scan_length,
+						   &worker->rand);
+		conn->db.scan_iterator = nb.scan_iterator;
+	} else if (!is_read) {
+		nb_value_next(&worker->values, &worker->rand, &conn->db.value,
+			      &conn->db.value_size);
+	}
+	if (ud->request->_do(&conn->db, key) == -1)
+		return io_request_failed(conn);
 	ud->request->requested++;
 	worker->workload.requested++;
-	nb_history_add(&worker->history, ud->request->type ==
-		       NB_SELECT ? RT_READ : RT_WRITE);
-	ud->prev_type = ud->request->type;
+	nb_history_add(&worker->history, is_read ? RT_READ : RT_WRITE);
+	conn->prev_type = ud->request->type;
 	ud->request = nb_workload_fetch(&worker->workload);
 	return 0;
 }
@@ -101,12 +279,27 @@ static void *io_write(struct async_io *io_obj, size_t *size)
 {
 	struct io_user_data *ud;
 	ud = (struct io_user_data *)async_io_get_user_data(io_obj);
-	struct nb_worker *worker = ud->worker;
-	if (io_write_impl(ud)) {
+	struct nb_worker_conn *conn;
+	conn = (struct nb_worker_conn *)async_io_get_conn_data(io_obj);
+	uint64_t now = nb.opts.get_time();
+	uint64_t time = now;
+	if (nb.opts.rps_arrival != NB_RPS_ADAPTIVE) {
+		/*
+		 * Measure latency from the intended send time, so the
+		 * time a request waited in the client is counted too.
+		 * It is kept in the get_time() domain: the schedule
+		 * start plus the offset of the request.
+		 */
+		uint64_t intended = ud->sched_start +
+			(uint64_t)(async_io_get_sched_time(io_obj) * 1e9);
+		if (intended < time)
+			time = intended;
+	}
+	if (io_write_impl(ud, conn, time, now)) {
 		async_io_finish(io_obj);
 		return NULL;
 	}
-	return nb.db->get_buf(&worker->db, size);
+	return nb.db->get_buf(&conn->db, size);
 }
 
 static int io_msg_len(struct async_io *io_obj, void *buf, size_t size)
@@ -115,81 +308,273 @@ static int io_msg_len(struct async_io *io_obj, void *buf, size_t size)
 	return nb.db->msg_len(buf, size);
 }
 
-static void process_latency(void *lat_arg, uint64_t latency)
+static void process_reply(void *reply_arg, struct nb_db_reply *reply)
 {
-	struct io_user_data *ud;
-	ud = (struct io_user_data *)lat_arg;
-	struct nb_worker *worker = ud->worker;
-	nb_histogram_add(worker->total_hist, latency);
-	nb_histogram_add(worker->period_hist, latency);
+	struct nb_worker_conn *conn = (struct nb_worker_conn *)reply_arg;
+	struct nb_inflight_entry *e = nb_inflight_find(&conn->inflight,
+						       reply->sync);
+	if (e == NULL)
+		return;
+	if (e->type == NB_RMW && e->stage == 0) {
+		/* The write is sent by the next write of the connection. */
+		nb_dependent_push(conn, reply->sync, reply->version);
+		return;
+	}
+	if (e->type == NB_RMW && reply->tuples == 0)
+		nb_history_add(&conn->worker->history, RT_CONFLICT);
+	if (e->type == NB_SCAN || e->type == NB_MULTI_SELECT)
+		nb_history_add_tuples(&conn->worker->history, reply->tuples);
+	uint64_t latency = nb.opts.get_time() - e->time;
+	nb_histogram_add(conn->worker->total_hist[e->type], latency);
+	nb_histogram_add(conn->worker->period_hist[e->type], latency);
+	nb_inflight_remove(&conn->inflight, e);
 }
 
 static int io_recv_from_buf(struct async_io *io_obj, char *buf,
 			    size_t size, size_t *off)
 {
-	struct io_user_data *ud;
-	ud = (struct io_user_data *)async_io_get_user_data(io_obj);
-	struct nb_worker *worker = ud->worker;
-	uint64_t latency = 0;
-	int rc = nb.db->recv_from_buf(buf, size, off, &latency);
-	process_latency(ud, latency);
-
-	nb_history_avg(&worker->history);
-	pthread_mutex_lock(&nb.stats.lock_stats);
-	nb_statistics_set(&nb.stats, worker->id, &worker->history.Savg);
-	pthread_mutex_unlock(&nb.stats.lock_stats);
+	struct nb_worker_conn *conn;
+	conn = (struct nb_worker_conn *)async_io_get_conn_data(io_obj);
+	struct nb_db_reply reply;
+	int rc = nb.db->recv_from_buf(buf, size, off, &reply);
+	if (rc == 0)
+		process_reply(conn, &reply);
 	return rc;
 }
 
+struct io_expire_ctx {
+	struct nb_worker_conn *conn;
+	uint64_t now;
+	int expired;
+};
+
+static void io_expire_request(void *arg, uint64_t sync)
+{
+	struct io_expire_ctx *ctx = (struct io_expire_ctx *)arg;
+	struct nb_worker_conn *conn = ctx->conn;
+	struct nb_inflight_entry *e = nb_inflight_find(&conn->inflight, sync);
+	if (e == NULL)
+		return;
+	uint64_t deadline = e->sent + io_timeout();
+	if (deadline > ctx->now) {
+		nb_wheel_add(&conn->wheel, deadline, sync);
+		return;
+	}
+	nb_inflight_remove(&conn->inflight, e);
+	nb_history_add(&conn->worker->history, RT_TIMEOUT);
+	ctx->expired++;
+}
+
+/*
+ * A connection with a timed out request is dropped: the server
+ * doesn't answer it in time and a late answer would be counted by
+ * async_io as an answer to another request.
+ */
+static int io_expire(struct async_io *io_obj)
+{
+	if (nb.is_done)
+		async_io_finish(io_obj);
+	struct io_expire_ctx ctx;
+	ctx.conn = (struct nb_worker_conn *)async_io_get_conn_data(io_obj);
+	ctx.now = nb.opts.get_time();
+	ctx.expired = 0;
+	nb_wheel_advance(&ctx.conn->wheel, ctx.now, io_expire_request, &ctx);
+	return ctx.expired != 0;
+}
+
+static int io_disconnect(struct async_io *io_obj)
+{
+	struct nb_worker_conn *conn;
+	conn = (struct nb_worker_conn *)async_io_get_conn_data(io_obj);
+	/* Requests of the lost connection are left without answers. */
+	for (size_t i = 0; i < conn->inflight.count; i++)
+		nb_history_add(&conn->worker->history, RT_TIMEOUT);
+	nb_inflight_clear(&conn->inflight);
+	conn->dependents_count = 0;
+	if (nb.opts.request_timeout)
+		nb_wheel_clear(&conn->wheel);
+	nb.db->close(&conn->db);
+	if (nb.is_done) {
+		async_io_finish(io_obj);
+		return -1;
+	}
+	return 0;
+}
+
+/* Called by a helper thread of async_io, touches only the db. */
+static int io_reconnect(void *conn_data)
+{
+	struct nb_worker_conn *conn = (struct nb_worker_conn *)conn_data;
+	if (nb.is_done || nb.db->connect(&conn->db, &nb.opts) == -1)
+		return -1;
+	return nb.db->get_fd(&conn->db);
+}
+
+/*
+ * Connect before the run. With reconnect_delay a failure is retried
+ * with growing delays, as a lost connection is.
+ */
+static int io_connect(struct nb_db *db)
+{
+	int delay = nb.opts.reconnect_delay;
+	int max_delay = nb.opts.reconnect_max_delay > delay ?
+			nb.opts.reconnect_max_delay : delay;
+	while (nb.db->connect(db, &nb.opts) == -1) {
+		if (delay == 0 || nb.is_done)
+			return -1;
+		struct timespec ts = { delay / 1000, delay % 1000 * 1000000L };
+		nanosleep(&ts, NULL);
+		delay = delay > max_delay / 2 ? max_delay : delay * 2;
+	}
+	return 0;
+}
+
+static uint32_t io_limit(void *arg, uint32_t count)
+{
+	return nb_rate_take((struct nb_rate *)arg, count);
+}
+
 static void *nb_worker(void *ptr)
 {
 	struct nb_worker *worker = ptr;
 
 	nb_worker_init();
 
-	nb.db->init(&worker->db, nb.opts.value_size);
-	if (nb.db->connect(&worker->db, &nb.opts) == -1)
+	/* Every connection is freed by nb_workers_free, init them first. */
+	for (; worker->conns_inited < worker->conns_count;
+	     worker->conns_inited++) {
+		struct nb_db *db = &worker->conns[worker->conns_inited].db;
+		nb.db->init(db, nb.opts.value_size);
+		db->multi_keys = nb.workers.multi_keys;
+	}
+	if (nb.opts.trace_file &&
+	    nb_trace_map(&nb.trace, worker->id % nb.trace.header.shards,
+			 &worker->trace) == -1)
 		return NULL;
+	if (nb.opts.trace_file) {
+		/*
+		 * Writes of the trace take prefixes of the arena head,
+		 * which is of the largest value size of the trace.
+		 */
+		uint32_t max = nb.trace.header.value_size_max;
+		struct nb_dist replay_size;
+		nb_dist_init(&replay_size, "fixed", 1, max ? max : 1);
+		nb_value_arena_create(&worker->values, &replay_size,
+				      nb.value_content,
+				      nb.opts.value_compression_ratio,
+				      &worker->rand);
+		nb_dist_free(&replay_size);
+	} else {
+		nb_value_arena_create(&worker->values, &nb.value_size,
+				      nb.value_content,
+				      nb.opts.value_compression_ratio,
+				      &worker->rand);
+	}
+	for (int i = 0; i < worker->conns_count; i++) {
+		struct nb_db *db = &worker->conns[i].db;
+		if (io_connect(db) == -1) {
+			printf("worker %d can't connect to %s:%d\n",
+			       worker->id, nb.opts.host, nb.opts.port);
+			goto error;
+		}
+		/* Deadlines are checked 16 times per timeout. */
+		if (nb.opts.request_timeout)
+			nb_wheel_init(&worker->conns[i].wheel, 32,
+				      io_timeout() / 16, nb.opts.get_time());
+	}
 
 	struct io_user_data userdata;
 	userdata.worker = worker;
 	userdata.request = NULL;
-	userdata.prev_type = NB_INSERT;
+	userdata.sched_start = 0;
 	if (nb.opts.request_batch_count) {
+		struct nb_worker_conn *conn = &worker->conns[0];
 		int rc = 0;
 		do {
 			int i = 0;
 			for (; i < nb.opts.request_batch_count; ++i) {
-				rc = io_write_impl(&userdata);
+				uint64_t now = nb.opts.get_time();
+				rc = io_write_impl(&userdata, conn, now, now);
 				if (rc)
 					break;
 			}
-			worker->db.dif->recv(&worker->db, i, NULL, process_latency, &userdata);
+			conn->db.dif->recv(&conn->db, i, NULL, process_reply, conn);
 			nb_history_add(&worker->history, RT_MISS);
-
-			nb_history_avg(&worker->history);
-			pthread_mutex_lock(&nb.stats.lock_stats);
-			nb_statistics_set(&nb.stats, worker->id, &worker->history.Savg);
-			pthread_mutex_unlock(&nb.stats.lock_stats);
 		} while (!rc);
 	} else {
-		struct async_io_if io_if = {io_msg_len, io_write, io_recv_from_buf};
+		struct async_io_if io_if = {io_msg_len, io_write, io_recv_from_buf,
+					    io_expire, NULL, NULL};
+		if (nb.opts.reconnect_delay) {
+			io_if.disconnect = io_disconnect;
+			io_if.reconnect = io_reconnect;
+		}
 		struct async_io *io_object;
-		int sock = nb.db->get_fd(&worker->db);
-		if (nb.opts.rps != 0) {
-			io_object = async_io_new_rps(sock, &io_if, nb.opts.rps,
+		if (nb.opts.rps_arrival != NB_RPS_ADAPTIVE) {
+			struct async_io_schedule schedule;
+			schedule.arrival =
+				nb.opts.rps_arrival == NB_RPS_POISSON ?
+				ASYNC_IO_ARRIVAL_POISSON :
+				nb.opts.rps_arrival == NB_RPS_STEP ?
+				ASYNC_IO_ARRIVAL_STEP :
+				ASYNC_IO_ARRIVAL_CONSTANT;
+			schedule.rps = nb.opts.rps;
+			schedule.step_rps = nb.opts.rps_step;
+			schedule.step_interval = nb.opts.rps_step_interval;
+			io_object = async_io_new_open(&io_if, &schedule,
+						      &userdata);
+		} else if (nb.opts.rps != 0) {
+			io_object = async_io_new_rps(&io_if, nb.opts.rps,
+						     &userdata);
+		} else if (nb.opts.total_rps != 0) {
+			/*
+			 * Any worker may get all the rate if others are
+			 * busy, the shared bucket holds the total.
+			 */
+			io_object = async_io_new_rps(&io_if,
+						     nb.opts.total_rps,
 						     &userdata);
+			if (io_object != NULL)
+				async_io_set_limit(io_object, io_limit,
+						   &nb.rate);
 		} else {
-			io_object = async_io_new(nb.db->get_fd(&worker->db), &io_if,
-						 &userdata);
+			io_object = async_io_new(&io_if, &userdata);
 		}
 		if (io_object == NULL)
 			goto error;
+		async_io_set_write_batch(io_object, nb.opts.send_batch_count,
+					 nb.opts.send_batch_size);
+		async_io_set_read_buf(io_object, nb.opts.buf_recv);
+		async_io_set_max_inflight(io_object, nb.opts.max_inflight);
+		if (nb.opts.request_timeout) {
+			double interval = nb.opts.request_timeout / 16000.0;
+			async_io_set_expire(io_object, interval > 0.001 ?
+					    interval : 0.001);
+		}
+		async_io_set_reconnect(io_object, nb.opts.reconnect_delay / 1000.0,
+				       nb.opts.reconnect_max_delay / 1000.0);
+		for (int i = 0; i < worker->conns_count; i++) {
+			struct nb_worker_conn *conn = &worker->conns[i];
+			int sock = nb.db->get_fd(&conn->db);
+			if (async_io_add(io_object, sock, conn) == -1) {
+				async_io_delete(io_object);
+				goto error;
+			}
+		}
+		/* async_io_start starts the schedule right away. */
+		userdata.sched_start = nb.opts.get_time();
 		async_io_start(io_object);
 
+		struct async_io_stat io_stat;
+		async_io_stat(io_object, &io_stat);
+		worker->io_received = io_stat.received;
+		worker->io_buf_allocs = io_stat.buf_allocs;
+		worker->io_reconnects = io_stat.reconnects;
+		worker->io_unavailable = io_stat.unavailable;
+		worker->io_unavailable_max = io_stat.unavailable_max;
 		async_io_delete(io_object);
 	}
 error:
+	nb_trace_unmap(&worker->trace);
 	return NULL;
 }
 
@@ -205,7 +590,7 @@ static void nb_create(void)
 				  nb.key,
 				  nb.key_dist,
 				  &nb.workload, 
-				  nb.opts.history_per_batch,
+				  nb.opts.connections,
 				  nb_worker);
 }
 
@@ -226,22 +611,30 @@ static void nb_create_step(void)
 					  nb.key,
 					  nb.key_dist,
 					  &nb.workload, 
-					  nb.opts.history_per_batch,
+					  nb.opts.connections,
 					  nb_worker);
 
-		pthread_mutex_lock(&nb.stats.lock_stats);
 		nb_statistics_resize(&nb.stats, nb.workers.count);
-		pthread_mutex_unlock(&nb.stats.lock_stats);
 	}
 }
 
 static void nb_report(void)
 {
-	pthread_mutex_lock(&nb.stats.lock_stats);
+	/*
+	 * Workers only count events, compute their rates since the
+	 * previous report. The list of workers and nb.stats are
+	 * changed only by this thread.
+	 */
+	struct nb_worker *worker = nb.workers.head;
+	for (; worker != NULL; worker = worker->next) {
+		struct nb_stat_avg avg;
+		memset(&avg, 0, sizeof(avg));
+		nb_history_rate(&worker->history, &worker->history_last, &avg);
+		nb_statistics_set(&nb.stats, worker->id, &avg);
+	}
 	nb_statistics_report(&nb.stats, nb.workers.count, nb.tick);
 	if (nb.report->report)
 		nb.report->report();
-	pthread_mutex_unlock(&nb.stats.lock_stats);
 }
 
 
@@ -291,6 +684,4 @@ void nb_engine(void)
 
 	if (nb.opts.csv_file)
 		nb_statistics_csv(&nb.stats, nb.opts.csv_file);
-
-	pthread_mutex_destroy(&nb.stats.lock_stats);
 }
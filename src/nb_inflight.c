@@ -0,0 +1,125 @@
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "nb_alloc.h"
+#include "nb_inflight.h"
+
+#define NB_INFLIGHT_MIN 16
+
+static void
+nb_inflight_alloc(struct nb_inflight *inflight, uint64_t size)
+{
+	inflight->entries = nb_malloc(sizeof(struct nb_inflight_entry) * size);
+	inflight->keys = nb_malloc(inflight->key_size * size);
+	inflight->mask = size - 1;
+	for (uint64_t i = 0; i < size; i++)
+		inflight->entries[i].type = -1;
+}
+
+void nb_inflight_init(struct nb_inflight *inflight, size_t key_size)
+{
+	inflight->key_size = key_size;
+	inflight->next_sync = 1;
+	inflight->count = 0;
+	nb_inflight_alloc(inflight, NB_INFLIGHT_MIN);
+}
+
+void nb_inflight_free(struct nb_inflight *inflight)
+{
+	free(inflight->entries);
+	free(inflight->keys);
+	inflight->entries = NULL;
+	inflight->keys = NULL;
+}
+
+void nb_inflight_clear(struct nb_inflight *inflight)
+{
+	for (uint64_t i = 0; i <= inflight->mask; i++)
+		inflight->entries[i].type = -1;
+	inflight->count = 0;
+}
+
+/*
+ * Double the table until every entry has its own slot, the
+ * syncs of a sparse window can still collide after a single
+ * doubling.
+ */
+static void nb_inflight_grow(struct nb_inflight *inflight)
+{
+	struct nb_inflight_entry *entries = inflight->entries;
+	char *keys = inflight->keys;
+	uint64_t size = inflight->mask + 1;
+	uint64_t new_size = size;
+retry:
+	new_size *= 2;
+	nb_inflight_alloc(inflight, new_size);
+	for (uint64_t i = 0; i < size; i++) {
+		if (entries[i].type == -1)
+			continue;
+		struct nb_inflight_entry *e =
+			&inflight->entries[entries[i].sync & inflight->mask];
+		if (e->type != -1) {
+			nb_inflight_free(inflight);
+			goto retry;
+		}
+		*e = entries[i];
+		memcpy((char *)nb_inflight_key(inflight, e),
+		       keys + i * inflight->key_size, inflight->key_size);
+	}
+	free(entries);
+	free(keys);
+}
+
+uint64_t nb_inflight_add(struct nb_inflight *inflight, uint64_t time,
+			 uint64_t sent, int type, const char *key,
+			 size_t key_size)
+{
+	uint64_t sync = inflight->next_sync++;
+	struct nb_inflight_entry *e = &inflight->entries[sync & inflight->mask];
+	while (e->type != -1) {
+		nb_inflight_grow(inflight);
+		e = &inflight->entries[sync & inflight->mask];
+	}
+	e->sync = sync;
+	e->time = time;
+	e->sent = sent;
+	e->type = type;
+	e->stage = 0;
+	if (key_size > inflight->key_size)
+		key_size = inflight->key_size;
+	memcpy((char *)nb_inflight_key(inflight, e), key, key_size);
+	inflight->count++;
+	return sync;
+}
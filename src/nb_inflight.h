@@ -0,0 +1,101 @@
+#ifndef NB_INFLIGHT_H_INCLUDED
+#define NB_INFLIGHT_H_INCLUDED
+
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Requests of a connection waiting for an answer. A request gets
+ * the next sync of the connection, it is sent to the server and
+ * comes back with the answer. The entry of a sync is found by its
+ * low bits, the table grows when the slot of a new sync is busy.
+ */
+struct nb_inflight_entry {
+	uint64_t sync;
+	/* Time latency is measured from, nanoseconds. */
+	uint64_t time;
+	/*
+	 * Time the request is really sent, the timeout is counted
+	 * from it. It is after the time if the request is late against
+	 * its intended send time.
+	 */
+	uint64_t sent;
+	/* enum nb_request_type, -1 for a free entry. */
+	int type;
+	/* Stage of a dependent request, 0 for the first one. */
+	int stage;
+};
+
+struct nb_inflight {
+	struct nb_inflight_entry *entries;
+	/* Keys of the entries, key_size bytes each. */
+	char *keys;
+	size_t key_size;
+	uint64_t mask;
+	uint64_t next_sync;
+	size_t count;
+};
+
+void nb_inflight_init(struct nb_inflight *inflight, size_t key_size);
+void nb_inflight_free(struct nb_inflight *inflight);
+/* Forget all requests. */
+void nb_inflight_clear(struct nb_inflight *inflight);
+
+/* Register a request, return its sync. */
+uint64_t nb_inflight_add(struct nb_inflight *inflight, uint64_t time,
+			 uint64_t sent, int type, const char *key,
+			 size_t key_size);
+
+/* Return the entry of the sync or NULL if it is unknown. */
+static inline struct nb_inflight_entry *
+nb_inflight_find(struct nb_inflight *inflight, uint64_t sync)
+{
+	struct nb_inflight_entry *e = &inflight->entries[sync & inflight->mask];
+	if (e->type == -1 || e->sync != sync)
+		return NULL;
+	return e;
+}
+
+static inline const char *
+nb_inflight_key(struct nb_inflight *inflight, struct nb_inflight_entry *e)
+{
+	return inflight->keys + (e - inflight->entries) * inflight->key_size;
+}
+
+static inline void
+nb_inflight_remove(struct nb_inflight *inflight, struct nb_inflight_entry *e)
+{
+	e->type = -1;
+	inflight->count--;
+}
+
+#endif
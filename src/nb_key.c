@@ -35,17 +35,70 @@
 #include <stdio.h>
 #include <time.h>
 
+#include <math.h>
+
 #include "nb_alloc.h"
+#include "nb_opt.h"
 #include "nb_key.h"
+#include "nb_dist.h"
+
+/*
+ * String keys are the prefix and the id padded with spaces to the
+ * width, like "K%10d". The terminating '\0' is a part of the key.
+ */
+static char nb_key_string_prefix[64] = "K";
+static size_t nb_key_string_prefix_len = 1;
+static size_t nb_key_string_width = 10;
+
+int nb_key_string_config(const char *prefix, int length)
+{
+	size_t len = strlen(prefix);
+	if (len >= sizeof(nb_key_string_prefix) || length <= (int)len)
+		return -1;
+	memcpy(nb_key_string_prefix, prefix, len + 1);
+	nb_key_string_prefix_len = len;
+	nb_key_string_width = length - len;
+	return 0;
+}
+
+static const char nb_key_digits[] =
+	"0001020304050607080910111213141516171819"
+	"2021222324252627282930313233343536373839"
+	"4041424344454647484950515253545556575859"
+	"6061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+/*
+ * Write the value to the buffer of the width right-aligned, two
+ * digits at a time. Only the lowest digits are written if the
+ * value is wider.
+ */
+static inline void
+nb_key_decimal(char *buf, size_t width, uint64_t v)
+{
+	char *p = buf + width;
+	while (v >= 10 && p - buf >= 2) {
+		p -= 2;
+		memcpy(p, nb_key_digits + (v % 100) * 2, 2);
+		v /= 100;
+	}
+	if (p > buf && (v > 0 || p == buf + width))
+		*--p = '0' + v % 10;
+	memset(buf, ' ', p - buf);
+}
 
 static void
-nb_key_string_init(struct nb_key *key, struct nb_key_distribution_if *distif)
+nb_key_string_init(struct nb_key *key, struct nb_key_distribution_if *distif,
+		   struct nb_rand *rand)
 {
-	/* 'K' + UINT_MAX(4294967295) + '\0' */
-	key->size = 12;
+	key->size = nb_key_string_prefix_len + nb_key_string_width + 1;
 	key->data = nb_malloc(key->size);
 	key->distif = distif;
-	snprintf(key->data, 12, "K%10d", 0);
+	key->rand = rand;
+	memcpy(key->data, nb_key_string_prefix, nb_key_string_prefix_len);
+	nb_key_decimal(key->data + nb_key_string_prefix_len,
+		       nb_key_string_width, 0);
+	key->data[key->size - 1] = 0;
 }
 
 static void
@@ -56,24 +109,28 @@ nb_key_string_free(struct nb_key *key)
 }
 
 static void
-nb_key_string_generate(struct nb_key *key, unsigned int max)
+nb_key_string_generate(struct nb_key *key, uint64_t max)
 {
-	unsigned int kv = key->distif->random(max);
-	snprintf(key->data, key->size, "K%10d", kv);
+	uint64_t kv = key->distif->random(key->rand, max);
+	nb_key_decimal(key->data + nb_key_string_prefix_len,
+		       nb_key_string_width, kv);
 }
 
 static void
-nb_key_string_generate_id(struct nb_key *key, unsigned int id)
+nb_key_string_generate_id(struct nb_key *key, uint64_t id)
 {
-	snprintf(key->data, key->size, "K%10d", id);
+	nb_key_decimal(key->data + nb_key_string_prefix_len,
+		       nb_key_string_width, id);
 }
 
 static void
-nb_key_u32_init(struct nb_key *key, struct nb_key_distribution_if *distif)
+nb_key_u32_init(struct nb_key *key, struct nb_key_distribution_if *distif,
+		struct nb_rand *rand)
 {
 	key->size = sizeof(uint32_t);
 	key->data = nb_malloc(key->size);
 	key->distif = distif;
+	key->rand = rand;
 	*((uint32_t*)key->data) = 0;
 }
 
@@ -85,23 +142,25 @@ nb_key_u32_free(struct nb_key *key)
 }
 
 static void
-nb_key_u32_generate(struct nb_key *key, unsigned int max)
+nb_key_u32_generate(struct nb_key *key, uint64_t max)
 {
-	*((uint32_t*)key->data) =  key->distif->random(max);
+	*((uint32_t*)key->data) =  key->distif->random(key->rand, max);
 }
 
 static void
-nb_key_u32_generate_id(struct nb_key *key, unsigned int id)
+nb_key_u32_generate_id(struct nb_key *key, uint64_t id)
 {
 	*((uint32_t*)key->data) = id;
 }
 
 static void
-nb_key_u64_init(struct nb_key *key, struct nb_key_distribution_if *distif)
+nb_key_u64_init(struct nb_key *key, struct nb_key_distribution_if *distif,
+		struct nb_rand *rand)
 {
 	key->size = sizeof(uint64_t);
 	key->data = nb_malloc(key->size);
 	key->distif = distif;
+	key->rand = rand;
 	*((uint64_t*)key->data) = 0;
 }
 
@@ -113,13 +172,13 @@ nb_key_u64_free(struct nb_key *key)
 }
 
 static void
-nb_key_u64_generate(struct nb_key *key, unsigned int max)
+nb_key_u64_generate(struct nb_key *key, uint64_t max)
 {
-	*((uint64_t*)key->data) =  key->distif->random(max);
+	*((uint64_t*)key->data) =  key->distif->random(key->rand, max);
 }
 
 static void
-nb_key_u64_generate_id(struct nb_key *key, unsigned int id)
+nb_key_u64_generate_id(struct nb_key *key, uint64_t id)
 {
 	*((uint64_t*)key->data) = id;
 }
@@ -152,6 +211,20 @@ struct nb_key_if nb_keys[] =
 	}
 };
 
+uint64_t nb_key_id_limit(struct nb_key_if *key_if)
+{
+	if (key_if->generate == nb_key_u32_generate)
+		return (uint64_t)UINT32_MAX + 1;
+	if (key_if->generate == nb_key_string_generate &&
+	    nb_key_string_width < 20) {
+		uint64_t limit = 1;
+		for (size_t i = 0; i < nb_key_string_width; i++)
+			limit *= 10;
+		return limit;
+	}
+	return 0;
+}
+
 struct nb_key_if *nb_key_match(const char *name)
 {
 	int i = 0;
@@ -163,45 +236,102 @@ struct nb_key_if *nb_key_match(const char *name)
 	return NULL;
 }
 
-static void nb_dist_uniform_init(int iterations)
-{
-	(void)iterations;
-	time_t tm = time(NULL);
-	srandom((unsigned int)tm);
-}
-
-static unsigned int nb_dist_uniform_random(unsigned int max)
+static uint64_t
+nb_dist_uniform_random(struct nb_rand *rand, uint64_t max)
 {
-	return random() % max;
+	return nb_rand_range64(rand, max);
 }
 
 static int gaussian_iter = 0;
 
-static void nb_dist_gaussian_init(int iterations)
+static void nb_dist_gaussian_init(struct nb_options *opts)
 {
-	time_t tm = time(NULL);
-	srandom((unsigned int)tm);
+	int iterations = opts->key_dist_iter;
 	if (iterations <= 0)
 		iterations = 1;
 	gaussian_iter = iterations;
 }
 
-static unsigned int nb_dist_gaussian_random(unsigned int max)
+static uint64_t
+nb_dist_gaussian_random(struct nb_rand *rand, uint64_t max)
 {
-	int sum = 0;
+	unsigned __int128 sum = 0;
 	int i = 0;
 	while (i < gaussian_iter) {
-		sum += random() % max;
+		sum += nb_rand_range64(rand, max);
 		i++;
 	}
-	return sum / gaussian_iter;
+	return (uint64_t)(sum / gaussian_iter);
+}
+
+/* Zipfian over the key space of request_count keys. */
+static struct nb_zipf zipf;
+
+static void nb_dist_zipf_init(struct nb_options *opts)
+{
+	nb_zipf_init(&zipf, opts->request_count, NB_ZIPF_THETA);
+}
+
+static uint64_t
+nb_dist_zipf_random(struct nb_rand *rand, uint64_t max)
+{
+	uint64_t v = nb_zipf_next(&zipf, rand);
+	return v < max ? v : v % max;
+}
+
+/* FNV-1a hash of the bytes of the value. */
+static inline uint64_t nb_dist_fnv(uint64_t v)
+{
+	uint64_t h = 0xcbf29ce484222325ull;
+	for (int i = 0; i < 8; i++) {
+		h ^= v & 0xff;
+		h *= 0x100000001b3ull;
+		v >>= 8;
+	}
+	return h;
+}
+
+/* Popular ids are scattered over the key space. */
+static uint64_t
+nb_dist_scrambled_zipf_random(struct nb_rand *rand, uint64_t max)
+{
+	return nb_dist_fnv(nb_zipf_next(&zipf, rand)) % max;
+}
+
+/* Popular ids are the highest, which are inserted last. */
+static uint64_t
+nb_dist_latest_random(struct nb_rand *rand, uint64_t max)
+{
+	uint64_t v = nb_zipf_next(&zipf, rand);
+	return max - 1 - (v < max ? v : v % max);
+}
+
+static double hotspot_ops;
+static double hotspot_keys;
+
+static void nb_dist_hotspot_init(struct nb_options *opts)
+{
+	hotspot_ops = opts->key_hotspot_ops / 100.0;
+	hotspot_keys = opts->key_hotspot_keys / 100.0;
+}
+
+/* The hot set is the lowest ids, both sets are uniform. */
+static uint64_t
+nb_dist_hotspot_random(struct nb_rand *rand, uint64_t max)
+{
+	uint64_t hot = max * hotspot_keys;
+	if (hot == 0)
+		hot = 1;
+	if (hot >= max || nb_rand_double(rand) < hotspot_ops)
+		return nb_rand_range64(rand, hot);
+	return hot + nb_rand_range64(rand, max - hot);
 }
 
 struct nb_key_distribution_if nb_key_dists[] =
 {
 	{
 		.name = "uniform",
-		.init = nb_dist_uniform_init,
+		.init = NULL,
 		.random = nb_dist_uniform_random
 	},
 	{
@@ -209,6 +339,26 @@ struct nb_key_distribution_if nb_key_dists[] =
 		.init = nb_dist_gaussian_init,
 		.random = nb_dist_gaussian_random
 	},
+	{
+		.name = "zipfian",
+		.init = nb_dist_zipf_init,
+		.random = nb_dist_zipf_random
+	},
+	{
+		.name = "scrambled_zipfian",
+		.init = nb_dist_zipf_init,
+		.random = nb_dist_scrambled_zipf_random
+	},
+	{
+		.name = "latest",
+		.init = nb_dist_zipf_init,
+		.random = nb_dist_latest_random
+	},
+	{
+		.name = "hotspot",
+		.init = nb_dist_hotspot_init,
+		.random = nb_dist_hotspot_random
+	},
 	{
 		.name = NULL
 	}
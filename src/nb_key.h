@@ -30,11 +30,17 @@
  * SUCH DAMAGE.
  */
 
-typedef unsigned int (*nb_key_randomf_t)(unsigned int max);
+#include "nb_rand.h"
+
+struct nb_options;
+
+/* Return an id in [0, max). */
+typedef uint64_t (*nb_key_randomf_t)(struct nb_rand *rand, uint64_t max);
 
 struct nb_key_distribution_if {
 	const char *name;
-	void (*init)(int iterations);
+	/* Called once before keys are generated, may be NULL. */
+	void (*init)(struct nb_options *opts);
 	nb_key_randomf_t random;
 };
 
@@ -42,14 +48,17 @@ struct nb_key {
 	char *data;
 	size_t size;
 	struct nb_key_distribution_if *distif;
+	/* Generator of the thread the key belongs to. */
+	struct nb_rand *rand;
 };
 
 struct nb_key_if {
 	const char *name;
-	void (*init)(struct nb_key *key, struct nb_key_distribution_if *distif);
+	void (*init)(struct nb_key *key, struct nb_key_distribution_if *distif,
+		     struct nb_rand *rand);
 	void (*free)(struct nb_key *key);
-	void (*generate)(struct nb_key *key, uint32_t max);
-	void (*generate_by_id)(struct nb_key *key, uint32_t id);
+	void (*generate)(struct nb_key *key, uint64_t max);
+	void (*generate_by_id)(struct nb_key *key, uint64_t id);
 };
 
 extern struct nb_key_if nb_keys[];
@@ -57,6 +66,20 @@ extern struct nb_key_distribution_if nb_key_dists[];
 
 struct nb_key_if *nb_key_match(const char *name);
 
+/*
+ * Set the format of string keys: @arg prefix followed by the id
+ * right-aligned in decimal, @arg length characters in total. Must
+ * be called before keys are initialized.
+ * Return -1 if there is no room for digits.
+ */
+int nb_key_string_config(const char *prefix, int length);
+
+/*
+ * Return the count of distinct ids the key type can represent,
+ * 0 if it is not limited.
+ */
+uint64_t nb_key_id_limit(struct nb_key_if *key_if);
+
 struct nb_key_distribution_if*
 nb_key_distribution_match(const char *name);
 
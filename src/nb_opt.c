@@ -34,42 +34,160 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
-#include <sys/time.h>
 #include <time.h>
 
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define NB_HAVE_TSC 1
+#endif
+
 #include "nb_alloc.h"
 #include "nb_opt.h"
 
 static uint64_t
-get_time_secs(void)
+get_time_monotonic(void)
 {
-	return time(0);
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
 }
 
+#if defined(NB_HAVE_TSC)
+
+/*
+ * TSC ticks are converted to nanoseconds as
+ * tsc_ns_base + (ticks - tsc_base) * tsc_mult / 2^32.
+ */
+static uint64_t tsc_base;
+static uint64_t tsc_ns_base;
+static uint64_t tsc_mult;
+
 static uint64_t
-get_time_milsecs(void)
+get_time_tsc(void)
 {
-	struct timeval tv;
-	gettimeofday(&tv, NULL);
-	return 1000 * tv.tv_sec + tv.tv_usec / 1000;
+	int64_t ticks = (int64_t)(__rdtsc() - tsc_base);
+	/*
+	 * TSCs of the cores may be slightly out of sync, so the
+	 * counter of another core can be behind the base.
+	 */
+	if (ticks < 0)
+		return tsc_ns_base;
+	return tsc_ns_base +
+	       (uint64_t)(((unsigned __int128)ticks * tsc_mult) >> 32);
 }
 
-static uint64_t
-get_time_micsecs(void)
+/*
+ * Measure the TSC frequency against CLOCK_MONOTONIC. Return -1 if
+ * the TSC is not invariant, so its rate depends on the power state
+ * of the core.
+ */
+static int
+tsc_calibrate(void)
+{
+	unsigned eax, ebx, ecx, edx;
+	if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0 ||
+	    (edx & (1u << 8)) == 0)
+		return -1;
+	uint64_t ns_start = get_time_monotonic();
+	uint64_t tsc_start = __rdtsc();
+	struct timespec ts = { 0, 50000000 };
+	nanosleep(&ts, NULL);
+	uint64_t ns_end = get_time_monotonic();
+	uint64_t tsc_end = __rdtsc();
+	if (tsc_end <= tsc_start)
+		return -1;
+	tsc_mult = ((ns_end - ns_start) << 32) / (tsc_end - tsc_start);
+	/* The base is 50ms in the past, far behind any core skew. */
+	tsc_base = tsc_start;
+	tsc_ns_base = ns_start;
+	return 0;
+}
+
+#endif
+
+get_time_f nb_time_source_match(const char *name)
 {
-	struct timeval tv;
-	gettimeofday(&tv, NULL);
-	return 1000000 * tv.tv_sec + tv.tv_usec;
+	if (!strcmp(name, "monotonic"))
+		return get_time_monotonic;
+#if defined(NB_HAVE_TSC)
+	if (!strcmp(name, "tsc")) {
+		if (tsc_calibrate() == -1)
+			return NULL;
+		return get_time_tsc;
+	}
+#endif
+	return NULL;
 }
 
-get_time_f time_functions[] = {
-	get_time_secs, get_time_milsecs, get_time_micsecs
+const uint64_t time_units_per_sec[] = {
+	1, 1000, 1000000, 1000000000
 };
 
 const char *latency_unit_strs[] = {
-	"secs ", "msecs", "usecs"
+	"secs ", "msecs", "usecs", "nsecs"
+};
+
+/*
+ * YCSB core workloads (Cooper et al., "Benchmarking cloud serving
+ * systems with YCSB"). Reads are selects and requests are chosen
+ * randomly, as YCSB does; inserts add new keys. Popular keys are
+ * scattered over the key space by scrambled zipfian, as the YCSB
+ * request distribution "zipfian" does.
+ */
+static const struct nb_profile {
+	const char *name;
+	int select;
+	int update;
+	int insert;
+	int scan;
+	int rmw;
+	char *key_dist;
+} nb_profiles[] = {
+	/* update heavy */
+	{ "ycsb_a", 50, 50, 0, 0, 0, "scrambled_zipfian" },
+	/* read mostly */
+	{ "ycsb_b", 95, 5, 0, 0, 0, "scrambled_zipfian" },
+	/* read only */
+	{ "ycsb_c", 100, 0, 0, 0, 0, "scrambled_zipfian" },
+	/* read latest */
+	{ "ycsb_d", 95, 0, 5, 0, 0, "latest" },
+	/* short ranges, scans of 1 - 100 tuples */
+	{ "ycsb_e", 0, 0, 5, 95, 0, "scrambled_zipfian" },
+	/* read-modify-write */
+	{ "ycsb_f", 50, 0, 0, 0, 50, "scrambled_zipfian" },
+	{ NULL, 0, 0, 0, 0, 0, NULL }
 };
 
+int nb_opt_profile(struct nb_options *opts, const char *name)
+{
+	const struct nb_profile *p = nb_profiles;
+	while (p->name && strcmp(p->name, name) != 0)
+		p++;
+	if (p->name == NULL)
+		return -1;
+	opts->dist_replace = 0;
+	opts->dist_update = p->update;
+	opts->dist_delete = 0;
+	opts->dist_select = p->select;
+	opts->dist_insert = p->insert;
+	opts->dist_scan = p->scan;
+	opts->dist_multi_select = 0;
+	opts->dist_multi_replace = 0;
+	opts->dist_rmw = p->rmw;
+	if (p->scan) {
+		free(opts->scan_length_dist);
+		opts->scan_length_dist = nb_strdup("uniform");
+		opts->scan_length_min = 1;
+		opts->scan_length_max = 100;
+	}
+	free(opts->key_dist);
+	opts->key_dist = nb_strdup(p->key_dist);
+	free(opts->request_mix);
+	opts->request_mix = nb_strdup("random");
+	return 0;
+}
+
 void nb_opt_init(struct nb_options *opts)
 {
 	opts->benchmark_policy = NB_BENCHMARK_NOLIMIT;
@@ -82,6 +200,7 @@ void nb_opt_init(struct nb_options *opts)
 	opts->threads_max = 10;
 	opts->threads_interval = 1;
 	opts->threads_increment = 1;
+	opts->connections = 1;
 	opts->request_count = 10000;
 	opts->request_batch_count = 0;
 	opts->history_per_batch = 16;
@@ -89,30 +208,81 @@ void nb_opt_init(struct nb_options *opts)
 	opts->key = nb_strdup("string");
 	opts->key_dist = nb_strdup("uniform");
 	opts->key_dist_iter = 4;
+	opts->key_hotspot_keys = 20;
+	opts->key_hotspot_ops = 80;
+	opts->random_seed = 0;
+	opts->key_prefix = nb_strdup("K");
+	opts->key_length = 11;
 	opts->value_size = 16;
+	opts->value_size_dist = nb_strdup("fixed");
+	opts->value_size_min = 1;
+	opts->value_size_histogram = NULL;
+	opts->value_content = nb_strdup("fill");
+	opts->value_compression_ratio = 2;
 	opts->dist_replace = 40;
 	opts->dist_update = 10;
 	opts->dist_delete = 10;
 	opts->dist_select = 40;
+	opts->dist_insert = 0;
+	opts->dist_scan = 0;
+	opts->scan_iterator = nb_strdup("ge");
+	opts->scan_length_dist = nb_strdup("uniform");
+	opts->scan_length_min = 1;
+	opts->scan_length_max = 100;
+	opts->dist_multi_select = 0;
+	opts->dist_multi_replace = 0;
+	opts->multi_key_count = 20;
+	opts->dist_rmw = 0;
+	opts->workload_profile = NULL;
+	opts->request_mix = nb_strdup("round_robin");
+	opts->request_mix_schedule = 100;
+	opts->trace_file = NULL;
 	opts->host = nb_strdup("127.0.0.1");
 	opts->port = 33013;
 	opts->buf_send = 16384;
 	opts->buf_recv = 16384;
+	opts->send_batch_count = 1;
+	opts->send_batch_size = 16384;
+	opts->max_inflight = 0;
+	opts->request_timeout = 0;
+	opts->reconnect_delay = 100;
+	opts->reconnect_max_delay = 5000;
+	opts->histogram_digits = 3;
 	opts->latency_measure_units = nb_strdup("microsec");
 	opts->latency_units = NB_LATENCY_MICSECS;
-	opts->get_time = time_functions[NB_LATENCY_MICSECS];
+	opts->time_source = nb_strdup("monotonic");
+	opts->get_time = get_time_monotonic;
 	opts->rps = 0;
+	opts->total_rps = 0;
+	opts->rps_arrival = NB_RPS_ADAPTIVE;
+	opts->rps_step = 0;
+	opts->rps_step_interval = 10;
+	opts->rps_pacing = nb_strdup("timer");
+	opts->io_engine = nb_strdup("libev");
 }
 
 void nb_opt_free(struct nb_options *opts)
 {
 	free(opts->benchmark_policy_name);
 	free(opts->threads_policy_name);
+	free(opts->rps_arrival_name);
 	free(opts->report);
+	free(opts->key_prefix);
+	free(opts->value_size_dist);
+	free(opts->value_size_histogram);
+	free(opts->value_content);
 	free(opts->csv_file);
 	free(opts->db);
 	free(opts->key);
 	free(opts->key_dist);
+	free(opts->request_mix);
+	free(opts->workload_profile);
+	free(opts->scan_iterator);
+	free(opts->scan_length_dist);
+	free(opts->trace_file);
 	free(opts->host);
 	free(opts->latency_measure_units);
+	free(opts->time_source);
+	free(opts->rps_pacing);
+	free(opts->io_engine);
 }
@@ -44,11 +44,26 @@ enum nb_policy_threads {
 enum nb_latency_units {
 	NB_LATENCY_SECS = 0,
 	NB_LATENCY_MILSECS,
-	NB_LATENCY_MICSECS
+	NB_LATENCY_MICSECS,
+	NB_LATENCY_NANOSECS
 };
 
+enum nb_rps_arrival {
+	NB_RPS_ADAPTIVE,
+	NB_RPS_CONSTANT,
+	NB_RPS_POISSON,
+	NB_RPS_STEP
+};
+
+/* Return time in nanoseconds. */
 typedef uint64_t (*get_time_f)(void);
-extern get_time_f time_functions[];
+/*
+ * Return the time source by its name: "monotonic" (CLOCK_MONOTONIC)
+ * or "tsc" (invariant TSC calibrated on the first call). NULL if
+ * the source is unknown or not supported.
+ */
+get_time_f nb_time_source_match(const char *name);
+extern const uint64_t time_units_per_sec[];
 extern const char *latency_unit_strs[];
 
 struct nb_options {
@@ -60,8 +75,9 @@ struct nb_options {
 	int report_interval;
 	char *report;
 
-	int request_count;
+	int64_t request_count;
 	int request_batch_count;
+	/* Obsolete, accepted for compatibility of configs. */
 	int history_per_batch;
 
 	enum nb_policy_threads threads_policy;
@@ -70,6 +86,7 @@ struct nb_options {
 	int threads_max;
 	int threads_increment;
 	int threads_interval;
+	int connections;
 
 	char *csv_file;
 
@@ -77,27 +94,88 @@ struct nb_options {
 	char *key;
 	char *key_dist;
 	int key_dist_iter;
-
+	/* Hotspot distribution: percent of ops on percent of keys. */
+	int key_hotspot_keys;
+	int key_hotspot_ops;
+	/* Seed of key generators, 0 - taken from the current time. */
+	int random_seed;
+	/* String keys: the prefix and the length without '\0'. */
+	char *key_prefix;
+	int key_length;
+
+	/* The largest value size. */
 	int value_size;
-	
+	/* fixed (value_size), uniform, zipfian or histogram. */
+	char *value_size_dist;
+	int value_size_min;
+	/* File of "size weight" lines of the histogram. */
+	char *value_size_histogram;
+	/* fill, random, compressible or json. */
+	char *value_content;
+	int value_compression_ratio;
+
 	int dist_replace;
 	int dist_update;
 	int dist_delete;
 	int dist_select;
+	int dist_insert;
+	int dist_scan;
+	/* ge, gt or le from the key. */
+	char *scan_iterator;
+	/* fixed (scan_length_max), uniform or zipfian. */
+	char *scan_length_dist;
+	int scan_length_min;
+	int scan_length_max;
+	int dist_multi_select;
+	int dist_multi_replace;
+	/* Keys of a multi-key request. */
+	int multi_key_count;
+	int dist_rmw;
+	/* Name of the profile of the workload, see nb_opt_profile(). */
+	char *workload_profile;
+	/* round_robin, random or shuffle, see nb_workload_mix. */
+	char *request_mix;
+	/* Length of the shuffled schedule of request types. */
+	int request_mix_schedule;
+	/* Replay requests of the trace instead of generating them. */
+	char *trace_file;
 
 	char *host;
 	int port;
 	int buf_send;
 	int buf_recv;
-
+	int send_batch_count;
+	int send_batch_size;
+	int max_inflight;
+	/* Milliseconds, 0 - requests never time out. */
+	int request_timeout;
+	/* Milliseconds, 0 - a lost connection stops its thread. */
+	int reconnect_delay;
+	int reconnect_max_delay;
+
+	int histogram_digits;
 	char *latency_measure_units;
 	enum nb_latency_units latency_units;
+	char *time_source;
 	get_time_f get_time;
 
 	int rps;
+	int total_rps;
+	char *rps_arrival_name;
+	enum nb_rps_arrival rps_arrival;
+	int rps_step;
+	int rps_step_interval;
+	char *rps_pacing;
+	char *io_engine;
 };
 
 void nb_opt_init(struct nb_options *opts);
 void nb_opt_free(struct nb_options *opts);
 
+/*
+ * Set the request percents, the key distribution and the request
+ * mix of the named profile. Return -1 if the profile is unknown.
+ */
+int nb_opt_profile(struct nb_options *opts, const char *name);
+
 #endif
@@ -0,0 +1,118 @@
+#ifndef NB_RAND_H_INCLUDED
+#define NB_RAND_H_INCLUDED
+
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+
+/*
+ * xoshiro256** generator. Every worker owns one, so no state is
+ * shared between threads, and a run is reproduced by its seed.
+ */
+struct nb_rand {
+	uint64_t s[4];
+};
+
+static inline uint64_t nb_rand_splitmix(uint64_t *x)
+{
+	uint64_t z = (*x += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+/* Close seeds give unrelated states, e.g. seed + worker id. */
+static inline void nb_rand_seed(struct nb_rand *r, uint64_t seed)
+{
+	for (int i = 0; i < 4; i++)
+		r->s[i] = nb_rand_splitmix(&seed);
+}
+
+static inline uint64_t nb_rand_rotl(uint64_t x, int k)
+{
+	return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t nb_rand_next(struct nb_rand *r)
+{
+	uint64_t *s = r->s;
+	uint64_t result = nb_rand_rotl(s[1] * 5, 7) * 9;
+	uint64_t t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = nb_rand_rotl(s[3], 45);
+	return result;
+}
+
+/*
+ * Return a uniform value in [0, max) by Lemire's multiply and
+ * shift, a biased low part is rejected instead of taking modulo.
+ */
+static inline uint32_t nb_rand_range(struct nb_rand *r, uint32_t max)
+{
+	uint64_t m = (nb_rand_next(r) >> 32) * max;
+	uint32_t low = (uint32_t)m;
+	if (low < max) {
+		uint32_t threshold = -max % max;
+		while (low < threshold) {
+			m = (nb_rand_next(r) >> 32) * max;
+			low = (uint32_t)m;
+		}
+	}
+	return m >> 32;
+}
+
+/* The same for the whole 64-bit range. */
+static inline uint64_t nb_rand_range64(struct nb_rand *r, uint64_t max)
+{
+	if (max <= UINT32_MAX)
+		return nb_rand_range(r, (uint32_t)max);
+	unsigned __int128 m = (unsigned __int128)nb_rand_next(r) * max;
+	uint64_t low = (uint64_t)m;
+	if (low < max) {
+		uint64_t threshold = -max % max;
+		while (low < threshold) {
+			m = (unsigned __int128)nb_rand_next(r) * max;
+			low = (uint64_t)m;
+		}
+	}
+	return m >> 64;
+}
+
+/* Return a uniform value in [0, 1). */
+static inline double nb_rand_double(struct nb_rand *r)
+{
+	return (nb_rand_next(r) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+#endif
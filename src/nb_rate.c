@@ -0,0 +1,76 @@
+
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <time.h>
+
+#include "nb_rate.h"
+
+static inline uint64_t nb_rate_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void nb_rate_init(struct nb_rate *rate, uint64_t rps, uint64_t burst)
+{
+	rate->interval = 1000000000ull / rps;
+	if (rate->interval == 0)
+		rate->interval = 1;
+	if (burst == 0)
+		burst = 1;
+	rate->depth = burst * rate->interval;
+	rate->tat = nb_rate_now();
+}
+
+uint32_t nb_rate_take(struct nb_rate *rate, uint32_t count)
+{
+	uint64_t now = nb_rate_now();
+	uint64_t tat = __atomic_load_n(&rate->tat, __ATOMIC_RELAXED);
+	uint64_t next;
+	uint32_t n;
+	do {
+		/* Tokens not claimed for long are capped by the depth. */
+		uint64_t base = tat;
+		if (now > rate->depth && base < now - rate->depth)
+			base = now - rate->depth;
+		if (base > now)
+			return 0;
+		uint64_t available = (now - base) / rate->interval;
+		if (available == 0)
+			return 0;
+		n = available < count ? available : count;
+		next = base + n * rate->interval;
+	} while (!__atomic_compare_exchange_n(&rate->tat, &tat, next, 1,
+					      __ATOMIC_RELAXED,
+					      __ATOMIC_RELAXED));
+	return n;
+}
@@ -0,0 +1,58 @@
+#ifndef NB_RATE_H_INCLUDED
+#define NB_RATE_H_INCLUDED
+
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+
+/*
+ * Token bucket shared by all workers to hold the aggregate request
+ * rate. It is kept as the time when the next token is generated
+ * (GCRA): a worker claims tokens by advancing this time with
+ * compare-and-swap, so no mutex is taken on the send path.
+ */
+struct nb_rate {
+	/* Interval between tokens in nanoseconds. */
+	uint64_t interval;
+	/* Length of a full bucket in nanoseconds (burst * interval). */
+	uint64_t depth;
+	/* Time of the next token, on its own cache line. */
+	uint64_t tat __attribute__((aligned(64)));
+};
+
+void nb_rate_init(struct nb_rate *rate, uint64_t rps, uint64_t burst);
+
+/*
+ * Claim up to count tokens. Return the count of claimed tokens,
+ * 0 if the bucket is empty.
+ */
+uint32_t nb_rate_take(struct nb_rate *rate, uint32_t count);
+
+#endif
@@ -52,6 +52,19 @@ static void nb_report_start(void)
 	       nb.opts.port);
 	printf("Report interval: %d sec\n", nb.opts.report_interval);
 	printf("Time units: %s\n", latency_unit_strs[nb.opts.latency_units]);
+	printf("Time source: %s\n", nb.opts.time_source);
+	printf("Random seed: %d\n", nb.opts.random_seed);
+	if (nb.opts.trace_file)
+		printf("Requests: replay of trace '%s', %" PRIu64
+		       " requests in %" PRIu32 " shards\n", nb.opts.trace_file,
+		       nb.trace.header.count, nb.trace.header.shards);
+	else if (nb.opts.workload_profile)
+		printf("Workload profile: %s\n", nb.opts.workload_profile);
+	else
+		printf("Request mix: %s\n", nb.opts.request_mix);
+	printf("Values: %s, %s size from %" PRIu64 " to %" PRIu64 " bytes\n",
+	       nb.opts.value_content, nb.opts.value_size_dist,
+	       nb.value_size.min, nb.value_size.max);
 	if (nb.opts.threads_policy == NB_THREADS_ATONCE) {
 		printf("Threads count: %d\n", nb.opts.threads_max);
 	} else {
@@ -60,10 +73,46 @@ static void nb_report_start(void)
 		       nb.opts.threads_max, nb.opts.threads_increment,
 		       nb.opts.threads_interval);
 	}
+	if (!nb.opts.request_batch_count)
+		printf("IO engine: %s\n", nb.opts.io_engine);
+	if (nb.opts.max_inflight && !nb.opts.request_batch_count)
+		printf("Max requests in flight per connection: %d\n",
+		       nb.opts.max_inflight);
+	if (nb.opts.total_rps)
+		printf("Total rps of all threads: %d\n", nb.opts.total_rps);
+	if ((nb.opts.rps || nb.opts.total_rps) && !nb.opts.request_batch_count)
+		printf("Rps pacing: %s\n", nb.opts.rps_pacing);
+	switch (nb.opts.rps_arrival) {
+	case NB_RPS_ADAPTIVE:
+		break;
+	case NB_RPS_CONSTANT:
+		printf("Open loop: %d rps per thread\n", nb.opts.rps);
+		break;
+	case NB_RPS_POISSON:
+		printf("Open loop: Poisson arrivals, %d rps per thread\n",
+		       nb.opts.rps);
+		break;
+	case NB_RPS_STEP:
+		printf("Open loop: %d rps per thread, increasing on %d "
+		       "every %d sec\n", nb.opts.rps, nb.opts.rps_step,
+		       nb.opts.rps_step_interval);
+		break;
+	}
+	if (nb.opts.connections > 1)
+		printf("Connections per thread: %d\n", nb.opts.connections);
+	if (!nb.opts.request_batch_count) {
+		if (nb.opts.request_timeout)
+			printf("Request timeout: %d ms\n",
+			       nb.opts.request_timeout);
+		if (nb.opts.reconnect_delay)
+			printf("Reconnect delay: from %d to %d ms\n",
+			       nb.opts.reconnect_delay,
+			       nb.opts.reconnect_max_delay);
+	}
 	printf("\n");
 }
 
-static void nb_report_default_progress(int processed, int max)
+static void nb_report_default_progress(uint64_t processed, uint64_t max)
 {
 	if (processed == 0 && max == 0) {
 		printf("\n\n");
@@ -82,14 +131,30 @@ static void nb_report_default_progress(int processed, int max)
 	fflush(NULL);
 }
 
+/* Multiplier of nanoseconds to get latency in the display units. */
+static double nb_report_scale(void)
+{
+	return (double)time_units_per_sec[nb.opts.latency_units] / 1e9;
+}
+
 static void nb_report_default(void)
 {
-	struct nb_histogram *period_hist = nb_histogram_new();
-	struct nb_worker *c = nb.workers.head;
-	while (c) {
-		nb_histogram_merge(period_hist, c->period_hist);
-		nb_histogram_clear(c->period_hist);
-		c = c->next;
+	double scale = nb_report_scale();
+	struct nb_histogram *period_hist =
+		nb_histogram_new(nb.opts.histogram_digits);
+	struct nb_histogram *op_hist[NB_REQUEST_MAX];
+	for (int i = 0; i < NB_REQUEST_MAX; i++) {
+		op_hist[i] = NULL;
+		if (!(nb.workers.hist_types & (1u << i)))
+			continue;
+		op_hist[i] = nb_histogram_new(nb.opts.histogram_digits);
+		struct nb_worker *c = nb.workers.head;
+		while (c) {
+			nb_histogram_merge(op_hist[i], c->period_hist[i]);
+			nb_histogram_clear(c->period_hist[i]);
+			c = c->next;
+		}
+		nb_histogram_merge(period_hist, op_hist[i]);
 	}
 	if ((nb.tick - 1) / nb.opts.report_interval % 5 == 0) {
 		printf("\n\n.---------.---------.---------.----------------.----------------.------------.------------.------------.\n"
@@ -103,11 +168,41 @@ static void nb_report_default(void)
 	       nb.stats.current->ps_req,
 	       nb.stats.current->ps_read,
 	       nb.stats.current->ps_write,
-	       period_hist->min, period_hist->max,
-	       nb_histogram_percentile(period_hist, 0.90),
-	       nb_histogram_percentile(period_hist, 0.99),
-	       nb_histogram_percentile(period_hist, 0.999));
+	       period_hist->min * scale, period_hist->max * scale,
+	       nb_histogram_percentile(period_hist, 0.90) * scale,
+	       nb_histogram_percentile(period_hist, 0.99) * scale,
+	       nb_histogram_percentile(period_hist, 0.999) * scale);
+	/* Per request type rows, only if there are several types. */
+	int op_rows = 0;
+	for (int i = 0; i < NB_REQUEST_MAX; i++) {
+		if (op_hist[i] == NULL || op_hist[i]->size == 0 ||
+		    op_hist[i]->size == period_hist->size)
+			continue;
+		printf("| %7d | %-17s |   %10.2lf   |   %10.2lf   |%12.2lf|%12.2lf|%12.2lf|\n",
+		       (int)(op_hist[i]->size / nb.opts.report_interval),
+		       nb_request_type_strs[i],
+		       op_hist[i]->min * scale, op_hist[i]->max * scale,
+		       nb_histogram_percentile(op_hist[i], 0.90) * scale,
+		       nb_histogram_percentile(op_hist[i], 0.99) * scale,
+		       nb_histogram_percentile(op_hist[i], 0.999) * scale);
+		op_rows++;
+	}
+	if (op_rows)
+		printf(".---------.---------.---------.----------------.----------------.------------.------------.------------.\n");
+	for (int i = 0; i < NB_REQUEST_MAX; i++) {
+		if (op_hist[i] != NULL)
+			nb_histogram_delete(op_hist[i]);
+	}
 	nb_histogram_delete(period_hist);
+	if (nb.opts.dist_scan || nb.opts.dist_multi_select)
+		printf("Tuples read: %d/s\n", nb.stats.current->ps_tuples);
+	static uint64_t timed_out = 0;
+	if (nb.stats.current->cnt_timeout != timed_out) {
+		printf("Timed out: %" PRIu64 " requests, %" PRIu64 " in total\n",
+		       nb.stats.current->cnt_timeout - timed_out,
+		       nb.stats.current->cnt_timeout);
+		timed_out = nb.stats.current->cnt_timeout;
+	}
 }
 
 static void nb_report_default_final(void)
@@ -119,9 +214,7 @@ static void nb_report_default_final(void)
 	".----------.---------------.---------------.---------------.\n"
 	"| read/s   |    %7d    |    %7d    |    %8d   |\n"
 	"| write/s  |    %7d    |    %7d    |    %8d   |\n"
-	"| req/s    |    %7d    |    %7d    |    %8d   |\n"
-	"'----------.---------------.---------------.---------------'\n"
-	"\n";
+	"| req/s    |    %7d    |    %7d    |    %8d   |\n";
 	printf(report, 
 	       nb.stats.final.ps_read_min,
 	       nb.stats.final.ps_read_avg,
@@ -132,15 +225,85 @@ static void nb_report_default_final(void)
 	       nb.stats.final.ps_req_min,
 	       nb.stats.final.ps_req_avg,
 	       nb.stats.final.ps_req_max);
+	if (nb.opts.dist_scan || nb.opts.dist_multi_select)
+		printf("| tuples/s |    %7d    |    %7d    |    %8d   |\n",
+		       nb.stats.final.ps_tuples_min,
+		       nb.stats.final.ps_tuples_avg,
+		       nb.stats.final.ps_tuples_max);
+	printf("'----------.---------------.---------------.---------------'\n"
+	       "\n");
+	if (nb.opts.dist_rmw)
+		printf("Read-modify-write conflicts: %" PRIu64 "\n",
+		       nb.stats.final.conflicts);
+	if (!nb.opts.request_batch_count) {
+		size_t received = 0, buf_allocs = 0;
+		struct nb_worker *c = nb.workers.head;
+		while (c) {
+			received += c->io_received;
+			buf_allocs += c->io_buf_allocs;
+			c = c->next;
+		}
+		printf("IO buffer allocations: %zu, per reply: %.6f\n",
+		       buf_allocs, received ? (double)buf_allocs / received : 0.0);
+		printf("Timed out requests: %" PRIu64 "\n",
+		       nb.stats.final.timed_out);
+		size_t reconnects = 0;
+		double unavailable = 0, unavailable_max = 0;
+		for (c = nb.workers.head; c != NULL; c = c->next) {
+			reconnects += c->io_reconnects;
+			unavailable += c->io_unavailable;
+			if (c->io_unavailable_max > unavailable_max)
+				unavailable_max = c->io_unavailable_max;
+		}
+		if (reconnects)
+			printf("Reconnects: %zu, connections were lost for "
+			       "%.3f sec, the longest gap %.3f sec\n",
+			       reconnects, unavailable, unavailable_max);
+	}
 	struct nb_histogram *res_hist;
 	printf("\nLATENCY HISTOGRAM:\n");
-	res_hist = nb_workers_merge_histogram(&nb.workers);
+	res_hist = nb_workers_merge_histogram(&nb.workers, NB_REQUEST_MAX);
 	double PERCENTILES[] = { 0.05, 0.50, 0.95, 0.96, 0.97, 0.98, 0.99,
 		0.995, 0.999, 0.9995, 0.9999 };
 	size_t PERCENTILES_SIZE = sizeof(PERCENTILES) / sizeof(PERCENTILES[0]);
 	nb_histogram_dump(res_hist, latency_unit_strs[nb.opts.latency_units],
-			  PERCENTILES, PERCENTILES_SIZE);
+			  nb_report_scale(), PERCENTILES, PERCENTILES_SIZE);
 	nb_histogram_delete(res_hist);
+
+	double scale = nb_report_scale();
+	const char *units = latency_unit_strs[nb.opts.latency_units];
+	printf("\nLATENCY BY REQUEST TYPE (%s):\n"
+	       ".---------.------------.------------.------------.------------.------------.------------.\n"
+	       "|  type   |   count    |  average   |     50%%<   |     99%%<   |    99.9%%<  |  maximum   |\n"
+	       ".---------.------------.------------.------------.------------.------------.------------.\n",
+	       units);
+	for (int i = 0; i < NB_REQUEST_MAX; i++) {
+		struct nb_histogram *hist =
+			nb_workers_merge_histogram(&nb.workers, i);
+		if (hist->size != 0) {
+			printf("| %-7s |%12zu|%12.2lf|%12.2lf|%12.2lf|%12.2lf|%12.2lf|\n",
+			       nb_request_type_strs[i], hist->size,
+			       hist->sum / hist->size * scale,
+			       nb_histogram_percentile(hist, 0.50) * scale,
+			       nb_histogram_percentile(hist, 0.99) * scale,
+			       nb_histogram_percentile(hist, 0.999) * scale,
+			       hist->max * scale);
+		}
+		/* Latency of a batch spread over its keys. */
+		if (hist->size != 0 &&
+		    (i == NB_MULTI_SELECT || i == NB_MULTI_REPLACE)) {
+			double key_scale = scale / nb.opts.multi_key_count;
+			printf("| %-7s |%12zu|%12.2lf|%12.2lf|%12.2lf|%12.2lf|%12.2lf|\n",
+			       " /key", hist->size * nb.opts.multi_key_count,
+			       hist->sum / hist->size * key_scale,
+			       nb_histogram_percentile(hist, 0.50) * key_scale,
+			       nb_histogram_percentile(hist, 0.99) * key_scale,
+			       nb_histogram_percentile(hist, 0.999) * key_scale,
+			       hist->max * key_scale);
+		}
+		nb_histogram_delete(hist);
+	}
+	printf("'---------.------------.------------.------------.------------.------------.------------'\n");
 }
 
 static void nb_report_integral(void)
@@ -35,8 +35,7 @@
 #include <stdio.h>
 #include <assert.h>
 
-#include <sys/types.h>
-#include <sys/time.h>
+#include <time.h>
 
 #include "nb_alloc.h"
 #include "nb_stat.h"
@@ -50,7 +49,6 @@ void nb_statistics_init(struct nb_statistics *s, int size)
 	s->tail = NULL;
 	memset(&s->current, 0, sizeof(s->current));
 	memset(&s->final, 0, sizeof(s->final));
-	pthread_mutex_init(&s->lock_stats, NULL);
 
 	nb_statistics_resize(s, size);
 }
@@ -73,21 +71,25 @@ void nb_statistics_resize(struct nb_statistics *s, int count)
 		return;
 	int bottom = s->count;
 	s->count = count;
-	s->stats = nb_realloc((void*)s->stats, count * sizeof(struct nb_stat));
+	s->stats = nb_realloc((void*)s->stats,
+			      count * sizeof(struct nb_stat_avg));
 	memset(s->stats + bottom, 0,
-	      (s->count - bottom) * sizeof(struct nb_stat));
+	      (s->count - bottom) * sizeof(struct nb_stat_avg));
 }
 
 static void
 nb_statistics_current(struct nb_statistics *s, struct nb_stat_avg *dest)
 {
-	memset(dest, 0, sizeof(struct nb_stat));
+	memset(dest, 0, sizeof(struct nb_stat_avg));
 	int i = 0;
 	for (; i < s->count; i++) {
 		dest->ps_read += s->stats[i].ps_read;
 		dest->ps_write += s->stats[i].ps_write;
 		dest->ps_req += s->stats[i].ps_req;
 		dest->cnt_miss += s->stats[i].cnt_miss;
+		dest->cnt_timeout += s->stats[i].cnt_timeout;
+		dest->cnt_conflict += s->stats[i].cnt_conflict;
+		dest->ps_tuples += s->stats[i].ps_tuples;
 	}
 }
 
@@ -117,10 +119,12 @@ void nb_statistics_final(struct nb_statistics *s)
 	s->final.ps_req_min = iter->ps_req;
 	s->final.ps_read_min = iter->ps_read;
 	s->final.ps_write_min = iter->ps_write;
+	s->final.ps_tuples_min = iter->ps_tuples;
 
-	int ps_req_sum = 0;
-	int ps_read_sum = 0;
-	int ps_write_sum = 0;
+	int64_t ps_tuples_sum = 0;
+	int64_t ps_req_sum = 0;
+	int64_t ps_read_sum = 0;
+	int64_t ps_write_sum = 0;
 
 	while (iter) {
 		if (iter->ps_req < s->final.ps_req_min)
@@ -138,6 +142,12 @@ void nb_statistics_final(struct nb_statistics *s)
 		if (iter->ps_read > s->final.ps_read_max)
 			s->final.ps_read_max = iter->ps_read;
 
+		if (iter->ps_tuples < s->final.ps_tuples_min)
+			s->final.ps_tuples_min = iter->ps_tuples;
+		if (iter->ps_tuples > s->final.ps_tuples_max)
+			s->final.ps_tuples_max = iter->ps_tuples;
+
+		ps_tuples_sum += iter->ps_tuples;
 		ps_req_sum += iter->ps_req;
 		ps_read_sum += iter->ps_read;
 		ps_write_sum += iter->ps_write;
@@ -147,8 +157,11 @@ void nb_statistics_final(struct nb_statistics *s)
 	s->final.ps_req_avg = ps_req_sum / s->count_report;
 	s->final.ps_read_avg = ps_read_sum / s->count_report;
 	s->final.ps_write_avg = ps_write_sum / s->count_report;
+	s->final.ps_tuples_avg = ps_tuples_sum / s->count_report;
 
 	s->final.missed = s->tail->cnt_miss;
+	s->final.timed_out = s->tail->cnt_timeout;
+	s->final.conflicts = s->tail->cnt_conflict;
 }
 
 static int nb_statistics_min_workers(struct nb_statistics *s) {
@@ -233,87 +246,39 @@ int nb_statistics_csv(struct nb_statistics *s, char *file)
 	return 0;
 }
 
-void nb_history_init(struct nb_history *s, int max)
+static uint64_t nb_history_time(void)
 {
-	s->Smax = max;
-	s->Scurrent = 0;
-	s->S = nb_malloc(sizeof(struct nb_stat) * max);
-	memset(s->S, 0, sizeof(struct nb_stat) * max);
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
 }
 
-void nb_history_free(struct nb_history *s)
+void nb_history_init(struct nb_history *s, struct nb_stat *last)
 {
-	if (s->S)
-		free(s->S);
+	memset(s, 0, sizeof(*s));
+	memset(last, 0, sizeof(*last));
+	last->time = nb_history_time();
 }
 
-unsigned long long nb_history_time(void)
+void nb_history_rate(struct nb_history *s, struct nb_stat *last,
+		     struct nb_stat_avg *avg)
 {
-	unsigned long long tm;
-	struct timeval tv;
-	gettimeofday(&tv, NULL);
-	tm = tv.tv_sec * 1000000ull;
-	tm += tv.tv_usec;
-	return tm;
-}
-
-void
-nb_history_add(struct nb_history *s, enum history_event_type e) {
-	long long t = nb_history_time();
-	long long epoch = t * s->Smax / 1000000;
-	if (epoch > s->epoch) {
-		long long e_start = s->epoch + 1;
-		if (e_start < epoch - s->Smax)
-			e_start = epoch - s->Smax;
-		for (long long e = e_start; e <= epoch; e++) {
-			long long pos = e % s->Smax;
-			s->S[pos].cnt_read = 0;
-			s->S[pos].cnt_write = 0;
-			s->S[pos].cnt_miss = 0;
-			s->S[pos].epoch = e;
-			s->S[pos].time_last_upd = e * 1000000 / 16;
-		}
-		s->epoch = epoch;
-	}
-	long long pos = epoch % s->Smax;
-	struct nb_stat *current = &s->S[pos];
-	if (e == RT_READ)
-		current->cnt_read++;
-	else if (e == RT_WRITE)
-		current->cnt_write++;
-	else if (e == RT_MISS)
-		current->cnt_miss++;
-	current->time_last_upd = t;
-}
-
-void nb_history_avg(struct nb_history *s)
-{
-	long long t = nb_history_time();
-	long long epoch = t * s->Smax / 1000000;
-	long long min_epoch = epoch - s->Smax + 1;
-	memset(&s->Savg, 0, sizeof(s->Savg));
-	int i = 0;
-	double total_time = 0;
-	int total_read = 0, total_write = 0, total_miss = 0;
-	for (; i < s->Smax; i++) {
-		if (s->S[i].epoch == epoch) {
-			long long diff =
-				s->S[i].time_last_upd - epoch * 1000000 / 16;
-			if (diff == 0)
-				continue;
-			total_time += (double)diff / 1000000;
-		} else if (s->S[i].epoch > epoch || s->S[i].epoch < min_epoch) {
-			continue;
-		} else {
-			total_time += 1. / s->Smax;
-		}
-		total_read += s->S[i].cnt_read;
-		total_write += s->S[i].cnt_write;
-		total_miss += s->S[i].cnt_miss;
-	}
+	struct nb_stat now;
+	now.cnt_read = __atomic_load_n(&s->cnt_read, __ATOMIC_RELAXED);
+	now.cnt_write = __atomic_load_n(&s->cnt_write, __ATOMIC_RELAXED);
+	now.cnt_miss = __atomic_load_n(&s->cnt_miss, __ATOMIC_RELAXED);
+	now.cnt_timeout = __atomic_load_n(&s->cnt_timeout, __ATOMIC_RELAXED);
+	now.cnt_conflict = __atomic_load_n(&s->cnt_conflict, __ATOMIC_RELAXED);
+	now.cnt_tuples = __atomic_load_n(&s->cnt_tuples, __ATOMIC_RELAXED);
+	now.time = nb_history_time();
+	double total_time = (double)(now.time - last->time) / 1000000000;
 	total_time = total_time == 0. ? 1. : total_time;
-	s->Savg.ps_read = (int)(total_read / total_time);
-	s->Savg.ps_write = (int)(total_write / total_time);
-	(void)total_miss;
-	s->Savg.ps_req = s->Savg.ps_read + s->Savg.ps_write;
+	avg->ps_read = (int)((now.cnt_read - last->cnt_read) / total_time);
+	avg->ps_write = (int)((now.cnt_write - last->cnt_write) / total_time);
+	avg->ps_req = avg->ps_read + avg->ps_write;
+	avg->ps_tuples = (int)((now.cnt_tuples - last->cnt_tuples) / total_time);
+	avg->cnt_miss = now.cnt_miss;
+	avg->cnt_timeout = now.cnt_timeout;
+	avg->cnt_conflict = now.cnt_conflict;
+	*last = now;
 }
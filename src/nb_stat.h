@@ -30,6 +30,7 @@
  * SUCH DAMAGE.
  */
 
+#include <stdint.h>
 #include <pthread.h>
 #include <assert.h>
 
@@ -37,7 +38,11 @@ struct nb_stat_avg {
 	int ps_read;
 	int ps_write;
 	int ps_req;
-	int cnt_miss;
+	uint64_t cnt_miss;
+	uint64_t cnt_timeout;
+	uint64_t cnt_conflict;
+	/* Tuples returned by scans. */
+	int ps_tuples;
 
 	int workers;
 	int time;
@@ -45,12 +50,19 @@ struct nb_stat_avg {
 };
 
 
+/* Size of a cache line, shared data of threads is aligned to it. */
+#define NB_CACHELINE_SIZE 64
+
+/* Counters of a worker taken by the reporter at a tick. */
 struct nb_stat {
-	int cnt_write;
-	int cnt_read;
-	int cnt_miss;
-	long long epoch;
-	long long time_last_upd;
+	uint64_t cnt_read;
+	uint64_t cnt_write;
+	uint64_t cnt_miss;
+	uint64_t cnt_timeout;
+	uint64_t cnt_conflict;
+	uint64_t cnt_tuples;
+	/* Time of the snapshot in nanoseconds. */
+	uint64_t time;
 };
 
 struct nb_stat_final {
@@ -63,17 +75,33 @@ struct nb_stat_final {
 	int ps_req_min;
 	int ps_req_max;
 	int ps_req_avg;
-	int missed;
+	int ps_tuples_min;
+	int ps_tuples_max;
+	int ps_tuples_avg;
+	uint64_t missed;
+	uint64_t timed_out;
+	uint64_t conflicts;
 };
 
+/*
+ * Event counters of a worker. The worker is the only writer and
+ * only increments them, the reporter thread reads them at its tick
+ * and computes rates by the difference with the previous snapshot.
+ * Every counter is stored atomically, so the reader never sees a
+ * torn value, and no locks or clock calls are on the hot path. The
+ * counters occupy their own cache line.
+ */
 struct nb_history {
-	int Smax, Scurrent;
-	struct nb_stat *S;
-	struct nb_stat_avg Savg;
-	long long epoch;
-	unsigned long long tm_start, tm_diff;
-
-};
+	uint64_t cnt_read;
+	uint64_t cnt_write;
+	uint64_t cnt_miss;
+	/* Requests left without an answer. */
+	uint64_t cnt_timeout;
+	/* Read-modify-writes whose tuple was changed after the read. */
+	uint64_t cnt_conflict;
+	/* Tuples returned by scans. */
+	uint64_t cnt_tuples;
+} __attribute__((aligned(NB_CACHELINE_SIZE)));
 
 struct nb_statistics {
 	struct nb_stat_avg *stats;
@@ -82,7 +110,6 @@ struct nb_statistics {
 	struct nb_stat_final final;
 	struct nb_stat_avg *head, *tail;
 	int count_report;
-	pthread_mutex_t lock_stats;
 };
 
 void nb_statistics_init(struct nb_statistics *s, int size);
@@ -97,7 +124,7 @@ nb_statistics_for(struct nb_statistics *s, int pos) {
 
 static inline void
 nb_statistics_set(struct nb_statistics *s, int pos, struct nb_stat_avg *v) {
-	memcpy(nb_statistics_for(s, pos), v, sizeof(struct nb_stat));
+	memcpy(nb_statistics_for(s, pos), v, sizeof(struct nb_stat_avg));
 }
 
 void nb_statistics_report(struct nb_statistics *s, int workers, int tick);
@@ -105,20 +132,46 @@ void nb_statistics_final(struct nb_statistics *s);
 double nb_statistics_sum(struct nb_statistics *s);
 int nb_statistics_csv(struct nb_statistics *s, char *file);
 
-void nb_history_init(struct nb_history *s, int max);
-void nb_history_free(struct nb_history *s);
-
-unsigned long long nb_history_time(void);
-
-void nb_history_avg(struct nb_history *s);
-
 enum history_event_type {
 	RT_READ,
 	RT_WRITE,
 	RT_MISS,
+	RT_TIMEOUT,
+	RT_CONFLICT,
 };
 
-void
-nb_history_add(struct nb_history *s, enum history_event_type e);
+/*
+ * Reset counters and take the first snapshot of them to last.
+ */
+void nb_history_init(struct nb_history *s, struct nb_stat *last);
+
+static inline void
+nb_history_add(struct nb_history *s, enum history_event_type e) {
+	uint64_t *cnt;
+	if (e == RT_READ)
+		cnt = &s->cnt_read;
+	else if (e == RT_WRITE)
+		cnt = &s->cnt_write;
+	else if (e == RT_MISS)
+		cnt = &s->cnt_miss;
+	else if (e == RT_CONFLICT)
+		cnt = &s->cnt_conflict;
+	else
+		cnt = &s->cnt_timeout;
+	__atomic_store_n(cnt, *cnt + 1, __ATOMIC_RELAXED);
+}
+
+static inline void
+nb_history_add_tuples(struct nb_history *s, uint32_t count) {
+	__atomic_store_n(&s->cnt_tuples, s->cnt_tuples + count,
+			 __ATOMIC_RELAXED);
+}
+
+/*
+ * Compute rates of events since the snapshot last into avg and
+ * replace last by the current snapshot. Called by the reporter.
+ */
+void nb_history_rate(struct nb_history *s, struct nb_stat *last,
+		     struct nb_stat_avg *avg);
 
 #endif
@@ -0,0 +1,282 @@
+
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "nosqlbench.h"
+
+extern struct nb nb;
+
+static uint32_t nb_trace_record_size(uint32_t key_size)
+{
+	size_t size = offsetof(struct nb_trace_record, key) + key_size;
+	return (size + 7) & ~(size_t)7;
+}
+
+/* Records of the shard n are [first, last). */
+static void nb_trace_shard_range(struct nb_trace_header *header, uint32_t n,
+				 uint64_t *first, uint64_t *last)
+{
+	*first = header->count * n / header->shards;
+	*last = header->count * (n + 1) / header->shards;
+}
+
+/*
+ * Requests of a shard are generated as a thread of a run would do:
+ * by the generator seeded by random_seed + the shard number, the
+ * deleted key is replaced by the next request.
+ */
+static int nb_trace_write_shard(FILE *f, struct nb_trace_header *header,
+				uint32_t n, struct nb_trace_record *rec)
+{
+	struct nb_rand rand;
+	nb_rand_seed(&rand, (uint64_t)nb.opts.random_seed + n);
+	struct nb_key key;
+	nb.key->init(&key, nb.key_dist, &rand);
+	struct nb_workload workload;
+	nb_workload_init_from(&workload, &nb.workload);
+	workload.rand = &rand;
+	nb_workload_reset(&workload);
+
+	int rc = 0;
+	struct nb_request *request = NULL;
+	enum nb_request_type prev_type = NB_INSERT;
+	uint64_t first, last;
+	nb_trace_shard_range(header, n, &first, &last);
+	for (uint64_t i = first; i < last; i++) {
+		if (prev_type == NB_DELETE) {
+			rec->type = NB_REPLACE;
+			prev_type = NB_INSERT;
+		} else {
+			if (request == NULL) {
+				nb_workload_reset(&workload);
+				request = nb_workload_fetch(&workload);
+				if (request == NULL) {
+					rc = -1;
+					break;
+				}
+			}
+			if (nb_request_key(&key, request->type) == -1) {
+				printf("error: inserts exceed %" PRIu64
+				       " distinct keys of key type '%s'\n",
+				       nb.key_id_limit, nb.opts.key);
+				rc = -1;
+				break;
+			}
+			rec->type = request->type;
+			request->requested++;
+			prev_type = request->type;
+			request = nb_workload_fetch(&workload);
+		}
+		workload.requested++;
+		if (rec->type == NB_SCAN)
+			rec->size = nb_dist_next(&nb.scan_length, &rand);
+		else
+			rec->size = nb_dist_next(&nb.value_size, &rand);
+		memcpy(rec->key, key.data, key.size);
+		if (fwrite(rec, header->record_size, 1, f) != 1) {
+			printf("error: write(): %s\n", strerror(errno));
+			rc = -1;
+			break;
+		}
+	}
+	nb_workload_free(&workload);
+	nb.key->free(&key);
+	return rc;
+}
+
+int nb_trace_write(const char *path)
+{
+	if (nb.opts.dist_multi_select || nb.opts.dist_multi_replace) {
+		printf("error: multi-key requests can't be traced\n");
+		return -1;
+	}
+	FILE *f = fopen(path, "w");
+	if (f == NULL) {
+		printf("error: trace file '%s': %s\n", path, strerror(errno));
+		return -1;
+	}
+	struct nb_key key;
+	nb.key->init(&key, nb.key_dist, NULL);
+	struct nb_trace_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, NB_TRACE_MAGIC, sizeof(header.magic));
+	snprintf(header.key_type, sizeof(header.key_type), "%s", nb.opts.key);
+	header.key_size = key.size;
+	header.record_size = nb_trace_record_size(key.size);
+	header.shards = nb.opts.threads_max;
+	header.value_size_max = nb.opts.value_size;
+	header.count = nb.opts.request_count;
+	nb.key->free(&key);
+	if (header.count < header.shards) {
+		printf("error: request_count is less than threads_max\n");
+		fclose(f);
+		return -1;
+	}
+
+	int rc = 0;
+	struct nb_trace_record *rec = nb_malloc(header.record_size);
+	memset(rec, 0, header.record_size);
+	if (fwrite(&header, sizeof(header), 1, f) != 1) {
+		printf("error: write(): %s\n", strerror(errno));
+		rc = -1;
+	}
+	for (uint32_t n = 0; rc == 0 && n < header.shards; n++)
+		rc = nb_trace_write_shard(f, &header, n, rec);
+	free(rec);
+	if (fclose(f) != 0 && rc == 0) {
+		printf("error: write(): %s\n", strerror(errno));
+		rc = -1;
+	}
+	if (rc == 0)
+		printf("Trace '%s': %" PRIu64 " requests in %" PRIu32
+		       " shards\n", path, header.count, header.shards);
+	return rc;
+}
+
+/*
+ * Collect the request types of all records, so the ones the driver
+ * can't send are rejected before the replay. Return -1 if a record
+ * is of an unknown type.
+ */
+static int nb_trace_types(struct nb_trace *trace, size_t file_size)
+{
+	struct nb_trace_header *h = &trace->header;
+	trace->types = 0;
+	if (h->count == 0)
+		return 0;
+	void *map = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE,
+			 trace->fd, 0);
+	if (map == MAP_FAILED) {
+		printf("error: mmap(): %s\n", strerror(errno));
+		return -1;
+	}
+	madvise(map, file_size, MADV_SEQUENTIAL);
+	const char *records = (const char *)map + sizeof(*h);
+	int rc = 0;
+	for (uint64_t i = 0; i < h->count; i++) {
+		const struct nb_trace_record *rec =
+			(const struct nb_trace_record *)
+			(records + i * h->record_size);
+		if (rec->type >= NB_REQUEST_MAX) {
+			printf("error: trace record %" PRIu64 " is of unknown "
+			       "request type %d\n", i, (int)rec->type);
+			rc = -1;
+			break;
+		}
+		trace->types |= 1u << rec->type;
+	}
+	munmap(map, file_size);
+	return rc;
+}
+
+int nb_trace_open(struct nb_trace *trace, const char *path)
+{
+	trace->fd = open(path, O_RDONLY);
+	if (trace->fd == -1) {
+		printf("error: trace file '%s': %s\n", path, strerror(errno));
+		return -1;
+	}
+	struct nb_trace_header *h = &trace->header;
+	struct stat st;
+	if (fstat(trace->fd, &st) == -1 ||
+	    pread(trace->fd, h, sizeof(*h), 0) != sizeof(*h) ||
+	    memcmp(h->magic, NB_TRACE_MAGIC, sizeof(h->magic)) != 0 ||
+	    h->shards == 0 ||
+	    h->key_type[sizeof(h->key_type) - 1] != 0 ||
+	    h->record_size != nb_trace_record_size(h->key_size) ||
+	    (uint64_t)st.st_size != sizeof(*h) + h->count * h->record_size) {
+		printf("error: '%s' is not a trace file\n", path);
+		close(trace->fd);
+		trace->fd = -1;
+		return -1;
+	}
+	if (nb_trace_types(trace, (size_t)st.st_size) == -1) {
+		close(trace->fd);
+		trace->fd = -1;
+		return -1;
+	}
+	return 0;
+}
+
+void nb_trace_close(struct nb_trace *trace)
+{
+	if (trace->fd != -1)
+		close(trace->fd);
+	trace->fd = -1;
+}
+
+int nb_trace_map(struct nb_trace *trace, uint32_t n,
+		 struct nb_trace_shard *shard)
+{
+	uint64_t first, last;
+	nb_trace_shard_range(&trace->header, n, &first, &last);
+	if (first == last) {
+		printf("error: trace shard %" PRIu32 " is empty\n", n);
+		return -1;
+	}
+	uint32_t record_size = trace->header.record_size;
+	off_t begin = sizeof(trace->header) + first * record_size;
+	off_t end = sizeof(trace->header) + last * record_size;
+	off_t map_begin = begin - begin % sysconf(_SC_PAGESIZE);
+	shard->map_size = end - map_begin;
+	shard->map = mmap(NULL, shard->map_size, PROT_READ, MAP_PRIVATE,
+			  trace->fd, map_begin);
+	if (shard->map == MAP_FAILED) {
+		printf("error: mmap(): %s\n", strerror(errno));
+		shard->map = NULL;
+		return -1;
+	}
+	madvise(shard->map, shard->map_size, MADV_SEQUENTIAL);
+	shard->records = (const char *)shard->map + (begin - map_begin);
+	shard->record_size = record_size;
+	shard->key_size = trace->header.key_size;
+	shard->count = last - first;
+	shard->pos = 0;
+	return 0;
+}
+
+void nb_trace_unmap(struct nb_trace_shard *shard)
+{
+	if (shard->map != NULL)
+		munmap(shard->map, shard->map_size);
+	shard->map = NULL;
+}
@@ -0,0 +1,109 @@
+#ifndef NB_TRACE_H_INCLUDED
+#define NB_TRACE_H_INCLUDED
+
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Trace of requests: a header and fixed size records of the type,
+ * the value size and the key of every request, in the host byte
+ * order. Records are split into shards, one per thread, a thread
+ * maps its shard and sends the requests in order, keys are sent
+ * right from the mapping. So runs against different servers send
+ * the same requests.
+ */
+#define NB_TRACE_MAGIC "NBTRACE1"
+
+struct nb_trace_header {
+	char magic[8];
+	/* Key type and key size the trace is written for. */
+	char key_type[16];
+	uint32_t key_size;
+	uint32_t record_size;
+	uint32_t shards;
+	uint32_t value_size_max;
+	uint64_t count;
+	char reserved[16];
+};
+
+struct nb_trace_record {
+	/* enum nb_request_type */
+	uint8_t type;
+	uint8_t reserved[3];
+	/* Value size of a write, tuple limit of a scan. */
+	uint32_t size;
+	char key[];
+};
+
+struct nb_trace {
+	int fd;
+	struct nb_trace_header header;
+	/* Mask of the request types of the records, 1 << type. */
+	uint32_t types;
+};
+
+/* Mapped records of a shard, replayed in a loop. */
+struct nb_trace_shard {
+	void *map;
+	size_t map_size;
+	const char *records;
+	uint32_t record_size;
+	uint32_t key_size;
+	uint64_t count;
+	uint64_t pos;
+};
+
+/*
+ * Write the trace of request_count requests generated by the key
+ * distribution and the request mix of the configuration, in
+ * threads_max shards.
+ */
+int nb_trace_write(const char *path);
+
+int nb_trace_open(struct nb_trace *trace, const char *path);
+void nb_trace_close(struct nb_trace *trace);
+
+int nb_trace_map(struct nb_trace *trace, uint32_t n,
+		 struct nb_trace_shard *shard);
+void nb_trace_unmap(struct nb_trace_shard *shard);
+
+static inline const struct nb_trace_record *
+nb_trace_next(struct nb_trace_shard *shard)
+{
+	const struct nb_trace_record *rec = (const struct nb_trace_record *)
+		(shard->records + shard->pos * shard->record_size);
+	if (++shard->pos == shard->count)
+		shard->pos = 0;
+	return rec;
+}
+
+#endif
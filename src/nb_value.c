@@ -0,0 +1,199 @@
+
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "nb_alloc.h"
+#include "nb_value.h"
+
+static const char *nb_value_contents[] = {
+	[NB_VALUE_FILL] = "fill",
+	[NB_VALUE_RANDOM] = "random",
+	[NB_VALUE_COMPRESSIBLE] = "compressible",
+	[NB_VALUE_JSON] = "json"
+};
+
+int nb_value_content_match(const char *name)
+{
+	int count = sizeof(nb_value_contents) / sizeof(nb_value_contents[0]);
+	for (int i = 0; i < count; i++) {
+		if (!strcmp(nb_value_contents[i], name))
+			return i;
+	}
+	return -1;
+}
+
+static void nb_value_random(char *p, size_t size, struct nb_rand *rand)
+{
+	while (size >= sizeof(uint64_t)) {
+		uint64_t r = nb_rand_next(rand);
+		memcpy(p, &r, sizeof(r));
+		p += sizeof(r);
+		size -= sizeof(r);
+	}
+	if (size) {
+		uint64_t r = nb_rand_next(rand);
+		memcpy(p, &r, size);
+	}
+}
+
+static void nb_value_alnum(char *p, size_t size, struct nb_rand *rand)
+{
+	static const char alnum[] = "0123456789"
+				    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+				    "abcdefghijklmnopqrstuvwxyz";
+	for (size_t i = 0; i < size; i++)
+		p[i] = alnum[nb_rand_range(rand, sizeof(alnum) - 1)];
+}
+
+/*
+ * A random part of 1 / ratio of the size repeated, LZ compressors
+ * shrink the value to about the part.
+ */
+static void nb_value_compressible(char *p, size_t size, int ratio,
+				  struct nb_rand *rand)
+{
+	size_t part = (size + ratio - 1) / ratio;
+	nb_value_random(p, part, rand);
+	for (size_t i = part; i < size; i += part)
+		memcpy(p + i, p, size - i < part ? size - i : part);
+}
+
+/*
+ * {"f0":"...","f1":"...",...} of 8 - 32 alphanumeric characters
+ * per field, the last field takes the rest of the size.
+ */
+static void nb_value_json(char *p, size_t size, struct nb_rand *rand)
+{
+	/* Room for one more field name and a character. */
+	const size_t field_min = 16;
+	if (size < field_min) {
+		nb_value_alnum(p, size, rand);
+		return;
+	}
+	/* The closing brace is at end. */
+	char *end = p + size - 1;
+	*p++ = '{';
+	for (int n = 0; ; n++) {
+		char name[24];
+		size_t len = snprintf(name, sizeof(name), "\"f%d\":\"", n);
+		size_t left = end - p;
+		size_t body = 8 + nb_rand_range(rand, 25);
+		/* The field with its quote and comma, then the next one. */
+		int last = left < len + body + 2 + field_min;
+		if (last)
+			body = left - len - 1;
+		memcpy(p, name, len);
+		p += len;
+		nb_value_alnum(p, body, rand);
+		p += body;
+		*p++ = '"';
+		if (last)
+			break;
+		*p++ = ',';
+	}
+	*p = '}';
+}
+
+static void nb_value_generate(char *p, size_t size,
+			      enum nb_value_content content, int ratio,
+			      struct nb_rand *rand)
+{
+	switch (content) {
+	case NB_VALUE_RANDOM:
+		nb_value_random(p, size, rand);
+		break;
+	case NB_VALUE_COMPRESSIBLE:
+		nb_value_compressible(p, size, ratio, rand);
+		break;
+	case NB_VALUE_JSON:
+		nb_value_json(p, size, rand);
+		break;
+	default:
+		memset(p, '#', size);
+		break;
+	}
+}
+
+void nb_value_arena_create(struct nb_value_arena *arena,
+			   const struct nb_dist *size,
+			   enum nb_value_content content, int ratio,
+			   struct nb_rand *rand)
+{
+	memset(arena, 0, sizeof(*arena));
+	/*
+	 * '#' values differ by the size only, so all of them are the
+	 * head, and values of the same size are equal, one is enough.
+	 */
+	int fill = content == NB_VALUE_FILL;
+	size_t total = NB_VALUE_ARENA_SIZE;
+	if (fill && size->type == NB_DIST_FIXED)
+		total = 1;
+	size_t head = size->max;
+	/* The last value may end past the total by its size. */
+	arena->data = nb_malloc(fill ? head : head + total + size->max);
+	nb_value_generate(arena->data, head, content, ratio, rand);
+	arena->data_size = head;
+	size_t drawn = 0;
+	size_t slots = 0;
+	while (drawn < total) {
+		if (arena->count == slots) {
+			slots = slots ? slots * 2 : 64;
+			arena->offsets = (size_t *)nb_realloc(
+				(char *)arena->offsets, sizeof(size_t) * slots);
+			arena->sizes = (size_t *)nb_realloc(
+				(char *)arena->sizes, sizeof(size_t) * slots);
+		}
+		size_t value_size = nb_dist_next(size, rand);
+		size_t offset = 0;
+		if (!fill) {
+			offset = arena->data_size;
+			nb_value_generate(arena->data + offset, value_size,
+					  content, ratio, rand);
+			arena->data_size += value_size;
+		}
+		arena->offsets[arena->count] = offset;
+		arena->sizes[arena->count] = value_size;
+		arena->count++;
+		/* An empty value still counts to end the loop. */
+		drawn += value_size ? value_size : 1;
+	}
+}
+
+void nb_value_arena_free(struct nb_value_arena *arena)
+{
+	free(arena->data);
+	free(arena->offsets);
+	free(arena->sizes);
+	memset(arena, 0, sizeof(*arena));
+}
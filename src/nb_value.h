@@ -0,0 +1,89 @@
+#ifndef NB_VALUE_H_INCLUDED
+#define NB_VALUE_H_INCLUDED
+
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+
+#include "nb_rand.h"
+#include "nb_dist.h"
+
+enum nb_value_content {
+	/* '#' bytes, as values were before. */
+	NB_VALUE_FILL,
+	/* Random bytes, incompressible. */
+	NB_VALUE_RANDOM,
+	/* Random bytes repeated, compressible by a ratio. */
+	NB_VALUE_COMPRESSIBLE,
+	/* Object of string fields, as documents of YCSB. */
+	NB_VALUE_JSON
+};
+
+/* Return the content of the name or -1 if it is unknown. */
+int nb_value_content_match(const char *name);
+
+/*
+ * Values generated before a run, a write takes one of them, so
+ * the hot path only picks an offset and a size. The data begins
+ * with the head: a value of the largest size that nb_value_next
+ * doesn't pick, a write of a size given from outside (a trace
+ * replay) sends a prefix of it. Values follow the head, '#' values
+ * are all prefixes of the head.
+ */
+struct nb_value_arena {
+	char *data;
+	size_t data_size;
+	size_t *offsets;
+	size_t *sizes;
+	size_t count;
+};
+
+/*
+ * Generate the head and about NB_VALUE_ARENA_SIZE bytes of values
+ * of the size distribution. ratio is of compressible values.
+ */
+#define NB_VALUE_ARENA_SIZE (4 * 1024 * 1024)
+
+void nb_value_arena_create(struct nb_value_arena *arena,
+			   const struct nb_dist *size,
+			   enum nb_value_content content, int ratio,
+			   struct nb_rand *rand);
+void nb_value_arena_free(struct nb_value_arena *arena);
+
+static inline void
+nb_value_next(const struct nb_value_arena *arena, struct nb_rand *rand,
+	      const char **value, size_t *size)
+{
+	size_t i = arena->count > 1 ? nb_rand_range(rand, arena->count) : 0;
+	*value = arena->data + arena->offsets[i];
+	*size = arena->sizes[i];
+}
+
+#endif
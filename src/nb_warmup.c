@@ -49,20 +49,26 @@ extern volatile sig_atomic_t nb_signaled;
 
 struct io_user_data {
 	struct nb_key *key;
-	size_t i;
+	struct nb_rand *rand;
+	struct nb_value_arena *values;
+	uint64_t i;
+	/* Progress is reported every step keys. */
+	uint64_t step;
 };
 
 static void *io_write(struct async_io *io_obj, size_t *size)
 {
 	struct io_user_data *ud = (struct io_user_data *)async_io_get_user_data(io_obj);
-	if ((int)ud->i >= nb.opts.request_count || nb_signaled) {
+	if (ud->i >= (uint64_t)nb.opts.request_count || nb_signaled) {
 		async_io_finish(io_obj);
 		return NULL;
 	}
 	nb.key->generate_by_id(ud->key, ud->i);
+	nb_value_next(ud->values, ud->rand, &db.value, &db.value_size);
 	nb.db->replace(&db, ud->key);
 	ud->i++;
-	if (nb.report->progress)
+	if (nb.report->progress &&
+	    (ud->i % ud->step == 0 || ud->i == (uint64_t)nb.opts.request_count))
 		nb.report->progress(ud->i, nb.opts.request_count);
 	return nb.db->get_buf(&db, size);
 }
@@ -86,18 +92,33 @@ int nb_warmup(void)
 	db.priv = NULL;
 
 	struct nb_key key;
-	nb.key->init(&key, nb.key_dist);
+	struct nb_rand rand;
+	nb_rand_seed(&rand, nb.opts.random_seed);
+	nb.key->init(&key, nb.key_dist, &rand);
+	struct nb_value_arena values;
+	nb_value_arena_create(&values, &nb.value_size, nb.value_content,
+			      nb.opts.value_compression_ratio, &rand);
 
 	nb.db->init(&db, nb.opts.value_size);
 	if (nb.db->connect(&db, &nb.opts) == -1) {
 		rc = 1;
 		goto error;
 	}
-	struct io_user_data userdata = {&key, 0};
-	struct async_io_if io_if = {io_msg_len, io_write, io_recv_from_buf};
-	struct async_io *io_object = async_io_new(nb.db->get_fd(&db), &io_if, &userdata);
+	uint64_t step = nb.opts.request_count / 10000;
+	struct io_user_data userdata = {&key, &rand, &values, 0,
+					step ? step : 1};
+	struct async_io_if io_if = {io_msg_len, io_write, io_recv_from_buf,
+				    NULL, NULL, NULL};
+	struct async_io *io_object = async_io_new(&io_if, &userdata);
 	if (io_object == NULL)
 		goto error;
+	async_io_set_write_batch(io_object, nb.opts.send_batch_count,
+				 nb.opts.send_batch_size);
+	async_io_set_read_buf(io_object, nb.opts.buf_recv);
+	if (async_io_add(io_object, nb.db->get_fd(&db), NULL) == -1) {
+		async_io_delete(io_object);
+		goto error;
+	}
 	async_io_start(io_object);
 
 	async_io_delete(io_object);
@@ -108,5 +129,6 @@ error:
 	nb.db->close(&db);
 	nb.db->free(&db);
 	nb.key->free(&key);
+	nb_value_arena_free(&values);
 	return rc;
 }
@@ -0,0 +1,109 @@
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "nb_alloc.h"
+#include "nb_wheel.h"
+
+void nb_wheel_init(struct nb_wheel *wheel, size_t slots,
+		   uint64_t resolution, uint64_t now)
+{
+	size_t size = 1;
+	while (size < slots)
+		size *= 2;
+	wheel->slots = nb_malloc(sizeof(struct nb_wheel_slot) * size);
+	memset(wheel->slots, 0, sizeof(struct nb_wheel_slot) * size);
+	wheel->mask = size - 1;
+	wheel->resolution = resolution > 0 ? resolution : 1;
+	wheel->tick = now / wheel->resolution;
+}
+
+void nb_wheel_free(struct nb_wheel *wheel)
+{
+	if (wheel->slots == NULL)
+		return;
+	for (uint64_t i = 0; i <= wheel->mask; i++)
+		free(wheel->slots[i].ids);
+	free(wheel->slots);
+	wheel->slots = NULL;
+}
+
+void nb_wheel_clear(struct nb_wheel *wheel)
+{
+	for (uint64_t i = 0; i <= wheel->mask; i++)
+		wheel->slots[i].count = 0;
+}
+
+void nb_wheel_add(struct nb_wheel *wheel, uint64_t deadline, uint64_t id)
+{
+	uint64_t tick = deadline / wheel->resolution;
+	if (tick < wheel->tick)
+		tick = wheel->tick;
+	struct nb_wheel_slot *slot = &wheel->slots[tick & wheel->mask];
+	if (slot->count == slot->size) {
+		slot->size = slot->size ? slot->size * 2 : 16;
+		slot->ids = nb_realloc((char *)slot->ids,
+				       sizeof(uint64_t) * slot->size);
+	}
+	slot->ids[slot->count++] = id;
+}
+
+void nb_wheel_advance(struct nb_wheel *wheel, uint64_t now,
+		      nb_wheel_expire_f expire, void *arg)
+{
+	uint64_t end = now / wheel->resolution;
+	if (end < wheel->tick)
+		return;
+	/* Every slot is visited once even if many ticks passed. */
+	if (end >= wheel->tick + wheel->mask)
+		wheel->tick = end - wheel->mask;
+	/*
+	 * The current tick is not over yet, its slot is visited again
+	 * by the next call.
+	 */
+	while (1) {
+		struct nb_wheel_slot *slot =
+			&wheel->slots[wheel->tick & wheel->mask];
+		/* Ids added back by the callback stay after count. */
+		size_t count = slot->count;
+		for (size_t i = 0; i < count; i++)
+			expire(arg, slot->ids[i]);
+		memmove(slot->ids, slot->ids + count,
+			sizeof(uint64_t) * (slot->count - count));
+		slot->count -= count;
+		if (wheel->tick == end)
+			break;
+		wheel->tick++;
+	}
+}
@@ -0,0 +1,74 @@
+#ifndef NB_WHEEL_H_INCLUDED
+#define NB_WHEEL_H_INCLUDED
+
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Hashed timer wheel of request deadlines. Time is split into
+ * ticks of resolution nanoseconds, an id is put into the slot of
+ * the tick of its deadline. Advancing the wheel hands the ids of
+ * passed slots to a callback, which checks the real deadline: a
+ * slot keeps ids of all rounds of the wheel, and ids of answered
+ * requests are not removed from it.
+ */
+struct nb_wheel_slot {
+	uint64_t *ids;
+	size_t count;
+	size_t size;
+};
+
+struct nb_wheel {
+	struct nb_wheel_slot *slots;
+	uint64_t mask;
+	uint64_t resolution;
+	/* The first tick not expired yet. */
+	uint64_t tick;
+};
+
+typedef void (*nb_wheel_expire_f)(void *arg, uint64_t id);
+
+void nb_wheel_init(struct nb_wheel *wheel, size_t slots,
+		   uint64_t resolution, uint64_t now);
+void nb_wheel_free(struct nb_wheel *wheel);
+void nb_wheel_clear(struct nb_wheel *wheel);
+
+void nb_wheel_add(struct nb_wheel *wheel, uint64_t deadline, uint64_t id);
+
+/*
+ * Expire slots of ticks up to now. The callback may add ids back
+ * to the wheel.
+ */
+void nb_wheel_advance(struct nb_wheel *wheel, uint64_t now,
+		      nb_wheel_expire_f expire, void *arg);
+
+#endif
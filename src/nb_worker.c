@@ -42,11 +42,16 @@
 #include "nb_stat.h"
 #include "nb_worker.h"
 
-void nb_workers_init(struct nb_workers *workers)
+void nb_workers_init(struct nb_workers *workers, int hist_digits,
+		     uint64_t seed, int multi_keys)
 {
 	workers->head = NULL;
 	workers->tail = NULL;
 	workers->count = 0;
+	workers->hist_digits = hist_digits;
+	workers->hist_types = (1u << NB_REQUEST_MAX) - 1;
+	workers->seed = seed;
+	workers->multi_keys = multi_keys;
 }
 
 void nb_workers_free(struct nb_workers *workers)
@@ -54,24 +59,46 @@ void nb_workers_free(struct nb_workers *workers)
 	struct nb_worker *c = workers->head, *n;
 	while (c) {
 		n = c->next;
-		c->db.dif->close(&c->db);
-		c->db.dif->free(&c->db);
-		c->key->free(&c->keyv);
-		nb_histogram_delete(c->total_hist);
-		nb_histogram_delete(c->period_hist);
-		nb_history_free(&c->history);
+		for (int i = 0; i < c->conns_count; i++) {
+			struct nb_worker_conn *conn = &c->conns[i];
+			if (i < c->conns_inited) {
+				conn->db.dif->close(&conn->db);
+				conn->db.dif->free(&conn->db);
+			}
+			c->key->free(&conn->keyv);
+			nb_inflight_free(&conn->inflight);
+			nb_wheel_free(&conn->wheel);
+			free(conn->dependents);
+		}
+		free(c->conns);
+		for (int i = 0; i < workers->multi_keys; i++)
+			c->key->free(&c->multi_keys[i]);
+		free(c->multi_keys);
+		nb_value_arena_free(&c->values);
+		nb_workload_free(&c->workload);
+		for (int i = 0; i < NB_REQUEST_MAX; i++) {
+			if (c->total_hist[i] == NULL)
+				continue;
+			nb_histogram_delete(c->total_hist[i]);
+			nb_histogram_delete(c->period_hist[i]);
+		}
 		free(c);
 		c = n;
 	}
 }
 
 struct nb_histogram *
-nb_workers_merge_histogram(struct nb_workers *workers)
+nb_workers_merge_histogram(struct nb_workers *workers,
+			   enum nb_request_type type)
 {
-	struct nb_histogram *res = nb_histogram_new();
+	struct nb_histogram *res = nb_histogram_new(workers->hist_digits);
 	struct nb_worker *c = workers->head;
 	while (c) {
-		nb_histogram_merge(res, c->total_hist);
+		for (int i = 0; i < NB_REQUEST_MAX; i++) {
+			if (c->total_hist[i] != NULL &&
+			    (type == NB_REQUEST_MAX || (int)type == i))
+				nb_histogram_merge(res, c->total_hist[i]);
+		}
 		c = c->next;
 	}
 	return res;
@@ -81,27 +108,54 @@ struct nb_worker*
 nb_workers_create(struct nb_workers *workers, struct nb_db_if *dif,
 		  struct nb_key_if *kif,
 		  struct nb_key_distribution_if *distif,
-		  struct nb_workload *workload, int history_max,
+		  struct nb_workload *workload, int conns_count,
 		  void *(*cb)(void *))
 {
-	struct nb_worker *n = nb_malloc(sizeof(struct nb_worker));
+	struct nb_worker *n = nb_malloc_aligned(NB_CACHELINE_SIZE,
+						sizeof(struct nb_worker));
 	memset(n, 0, sizeof(struct nb_worker));
 
 	n->id = workers->count;
-	n->db.dif = dif;
-	n->db.priv = NULL;
-
 	n->key = kif;
-	n->key->init(&n->keyv, distif);
-	n->total_hist = nb_histogram_new();
-	n->period_hist = nb_histogram_new();
+	nb_rand_seed(&n->rand, workers->seed + n->id);
+	n->conns_count = conns_count;
+	n->conns = nb_malloc(sizeof(struct nb_worker_conn) * conns_count);
+	memset(n->conns, 0, sizeof(struct nb_worker_conn) * conns_count);
+	for (int i = 0; i < conns_count; i++) {
+		struct nb_worker_conn *conn = &n->conns[i];
+		conn->worker = n;
+		conn->db.dif = dif;
+		conn->db.priv = NULL;
+		conn->prev_type = NB_INSERT;
+		n->key->init(&conn->keyv, distif, &n->rand);
+		nb_inflight_init(&conn->inflight, conn->keyv.size);
+	}
+	if (workers->multi_keys) {
+		n->multi_keys = nb_malloc(sizeof(struct nb_key) *
+					  workers->multi_keys);
+		for (int i = 0; i < workers->multi_keys; i++)
+			n->key->init(&n->multi_keys[i], distif, &n->rand);
+	}
+	for (int i = 0; i < NB_REQUEST_MAX; i++) {
+		if (!(workers->hist_types & (1u << i)))
+			continue;
+		n->total_hist[i] = nb_histogram_new(workers->hist_digits);
+		n->period_hist[i] = nb_histogram_new(workers->hist_digits);
+	}
 
-	nb_history_init(&n->history, history_max);
+	nb_history_init(&n->history, &n->history_last);
 	nb_workload_init_from(&n->workload, workload);
+	n->workload.rand = &n->rand;
 
 	if (pthread_create(&n->tid, NULL, cb, (void*)n) == -1) {
-		n->key->free(&n->keyv);
-		nb_history_free(&n->history);
+		for (int i = 0; i < conns_count; i++) {
+			n->key->free(&n->conns[i].keyv);
+			nb_inflight_free(&n->conns[i].inflight);
+		}
+		for (int i = 0; i < workers->multi_keys; i++)
+			n->key->free(&n->multi_keys[i]);
+		free(n->multi_keys);
+		free(n->conns);
 		free(n);
 		return NULL;
 	}
@@ -34,16 +34,63 @@
 #include "nb_histogram.h"
 #include "nb_workload.h"
 #include "nb_key.h"
+#include "nb_inflight.h"
+#include "nb_wheel.h"
+#include "nb_trace.h"
+#include "nb_value.h"
+
+struct nb_worker;
+
+/* Answered read of a read-modify-write, its write is sent next. */
+struct nb_dependent {
+	uint64_t sync;
+	uint64_t version;
+};
+
+struct nb_worker_conn {
+	struct nb_worker *worker;
+	struct nb_db db;
+	struct nb_key keyv;
+	/* Requests sent and not answered yet. */
+	struct nb_inflight inflight;
+	/* Deadlines of the requests if request_timeout is set. */
+	struct nb_wheel wheel;
+	enum nb_request_type prev_type;
+	/* Ring of dependent requests ready to be sent. */
+	struct nb_dependent *dependents;
+	size_t dependents_head;
+	size_t dependents_count;
+	size_t dependents_size;
+};
 
 struct nb_worker {
 	int id;
-	struct nb_db db;
+	struct nb_worker_conn *conns;
+	int conns_count;
+	/* Connections with the db initialized, freed with the worker. */
+	int conns_inited;
 	struct nb_key_if *key;
-	struct nb_key keyv;
+	/* Generator of keys, seeded by the seed of workers and id. */
+	struct nb_rand rand;
+	/* Keys of the next multi-key request. */
+	struct nb_key *multi_keys;
+	/* Values of writes, generated by the thread. */
+	struct nb_value_arena values;
 	struct nb_workload workload;
+	/* Shard of the trace, mapped by the thread if it is replayed. */
+	struct nb_trace_shard trace;
 	struct nb_history history;
-	struct nb_histogram *total_hist;
-	struct nb_histogram *period_hist;
+	/* Snapshot of history at the previous report, reporter only. */
+	struct nb_stat history_last;
+	/* Latency histograms by enum nb_request_type. */
+	struct nb_histogram *total_hist[NB_REQUEST_MAX];
+	struct nb_histogram *period_hist[NB_REQUEST_MAX];
+	/* async io counters, set when the worker finishes */
+	size_t io_received;
+	size_t io_buf_allocs;
+	size_t io_reconnects;
+	double io_unavailable;
+	double io_unavailable_max;
 	pthread_t tid;
 	struct nb_worker *next;
 };
@@ -51,19 +98,35 @@ struct nb_worker {
 struct nb_workers {
 	struct nb_worker *head, *tail;
 	volatile int count;
+	/* Significant digits of latency histograms. */
+	int hist_digits;
+	/*
+	 * Mask of the request types that can be sent, 1 << type. Only
+	 * they have latency histograms, the others are NULL.
+	 */
+	uint32_t hist_types;
+	uint64_t seed;
+	/* Keys of a multi-key request, 0 if there are none. */
+	int multi_keys;
 };
 
-void nb_workers_init(struct nb_workers *workers);
+void nb_workers_init(struct nb_workers *workers, int hist_digits,
+		     uint64_t seed, int multi_keys);
 void nb_workers_free(struct nb_workers *workers);
 
+/*
+ * Merge total latency histograms of requests of the type,
+ * of all requests if the type is NB_REQUEST_MAX.
+ */
 struct nb_histogram *
-nb_workers_merge_histogram(struct nb_workers *workers);
+nb_workers_merge_histogram(struct nb_workers *workers,
+			   enum nb_request_type type);
 
 struct nb_worker*
 nb_workers_create(struct nb_workers *workers, struct nb_db_if *dif,
 		  struct nb_key_if *kif,
 		  struct nb_key_distribution_if *distif,
-		  struct nb_workload *workload, int history_max,
+		  struct nb_workload *workload, int conns_count,
 		  void *(*cb)(void *));
 
 void nb_workers_join(struct nb_workers *workers);
@@ -39,6 +39,94 @@
 #include "nb_key.h"
 #include "nb_workload.h"
 
+const char *nb_request_type_strs[] =
+{
+	"replace",
+	"update",
+	"delete",
+	"select",
+	"insert",
+	"scan",
+	"mget",
+	"mset",
+	"rmw"
+};
+
+/* Vose's method, the percents of the types sum up to 100. */
+static void nb_workload_alias(struct nb_workload *workload)
+{
+	double scaled[NB_REQUEST_MAX];
+	int small[NB_REQUEST_MAX], large[NB_REQUEST_MAX];
+	int n = 0, nsmall = 0, nlarge = 0, total = 0;
+	for (int i = 0; i < NB_REQUEST_MAX; i++) {
+		if (workload->reqs[i].percent <= 0)
+			continue;
+		workload->alias_req[n++] = &workload->reqs[i];
+		total += workload->reqs[i].percent;
+	}
+	workload->alias_size = n;
+	for (int i = 0; i < n; i++) {
+		scaled[i] = (double)workload->alias_req[i]->percent * n / total;
+		if (scaled[i] < 1.0)
+			small[nsmall++] = i;
+		else
+			large[nlarge++] = i;
+	}
+	while (nsmall > 0 && nlarge > 0) {
+		int s = small[--nsmall];
+		int l = large[--nlarge];
+		workload->alias_prob[s] = scaled[s];
+		workload->alias_alt[s] = workload->alias_req[l];
+		scaled[l] -= 1.0 - scaled[s];
+		if (scaled[l] < 1.0)
+			small[nsmall++] = l;
+		else
+			large[nlarge++] = l;
+	}
+	/* The rest are full columns, up to rounding errors. */
+	while (nlarge > 0) {
+		int l = large[--nlarge];
+		workload->alias_prob[l] = 1.0;
+		workload->alias_alt[l] = workload->alias_req[l];
+	}
+	while (nsmall > 0) {
+		int s = small[--nsmall];
+		workload->alias_prob[s] = 1.0;
+		workload->alias_alt[s] = workload->alias_req[s];
+	}
+}
+
+/*
+ * Every type takes its share of the schedule rounded by the
+ * cumulative percents, so the shares sum up to the size, then
+ * the schedule is shuffled by Fisher-Yates.
+ */
+static void nb_workload_schedule(struct nb_workload *workload)
+{
+	size_t size = workload->schedule_size;
+	if (workload->schedule == NULL)
+		workload->schedule = nb_malloc(sizeof(struct nb_request *) *
+					       size);
+	int total = 0, cumulative = 0;
+	for (int i = 0; i < workload->alias_size; i++)
+		total += workload->alias_req[i]->percent;
+	size_t n = 0;
+	for (int i = 0; i < workload->alias_size; i++) {
+		cumulative += workload->alias_req[i]->percent;
+		size_t end = (uint64_t)size * cumulative / total;
+		while (n < end)
+			workload->schedule[n++] = workload->alias_req[i];
+	}
+	workload->schedule_size = n;
+	for (size_t i = n; i > 1; i--) {
+		size_t j = nb_rand_range(workload->rand, i);
+		struct nb_request *tmp = workload->schedule[i - 1];
+		workload->schedule[i - 1] = workload->schedule[j];
+		workload->schedule[j] = tmp;
+	}
+	workload->schedule_pos = 0;
+}
+
 void nb_workload_link(struct nb_workload *workload) {
 	int i = 0;
 	struct nb_request *head = NULL;
@@ -56,6 +144,9 @@ void nb_workload_link(struct nb_workload *workload) {
 		i++;
 	}
 	workload->head = head;
+	nb_workload_alias(workload);
+	if (workload->mix == NB_MIX_SHUFFLE && workload->rand)
+		nb_workload_schedule(workload);
 }
 
 static void nb_workload_unlink(struct nb_workload *workload) {
@@ -68,7 +159,7 @@ static void nb_workload_unlink(struct nb_workload *workload) {
 		workload->head = c->next;
 }
 
-void nb_workload_init(struct nb_workload *workload, int count)
+void nb_workload_init(struct nb_workload *workload, uint64_t count)
 {
 	workload->count = count;
 	workload->count_write = 0;
@@ -78,14 +169,45 @@ void nb_workload_init(struct nb_workload *workload, int count)
 	workload->head = NULL;
 	workload->current = NULL;
 	memset(workload->reqs, 0, sizeof(workload->reqs));
+	workload->mix = NB_MIX_ROUND_ROBIN;
+	workload->alias_size = 0;
+	workload->schedule = NULL;
+	workload->schedule_size = 0;
+	workload->schedule_pos = 0;
+	workload->rand = NULL;
+}
+
+void nb_workload_free(struct nb_workload *workload)
+{
+	free(workload->schedule);
+	workload->schedule = NULL;
+}
+
+int nb_workload_set_mix(struct nb_workload *workload, const char *name,
+			int schedule_size)
+{
+	if (!strcmp(name, "round_robin"))
+		workload->mix = NB_MIX_ROUND_ROBIN;
+	else if (!strcmp(name, "random"))
+		workload->mix = NB_MIX_RANDOM;
+	else if (!strcmp(name, "shuffle"))
+		workload->mix = NB_MIX_SHUFFLE;
+	else
+		return -1;
+	if (workload->mix == NB_MIX_SHUFFLE && schedule_size <= 0)
+		return -1;
+	workload->schedule_size = schedule_size > 0 ? schedule_size : 0;
+	return 0;
 }
 
 void nb_workload_init_from(struct nb_workload *dest, struct nb_workload *src)
 {
 	nb_workload_init(dest, src->count);
+	dest->mix = src->mix;
+	dest->schedule_size = src->schedule_size;
 	int i = 0;
 	while (i < NB_REQUEST_MAX) {
-		nb_workload_add(dest, src->reqs[i].type,
+		nb_workload_add(dest, (enum nb_request_type)i,
 				src->reqs[i]._do,
 				src->reqs[i].percent);
 		i++;
@@ -100,7 +222,9 @@ void nb_workload_add(struct nb_workload *workload, enum nb_request_type type,
 	r->type = type;
 	r->percent = percent;
 	r->requested = 0;
-	r->count = (int)(workload->count * r->percent / 100.0);
+	/* Exact for any count, the product could overflow. */
+	r->count = workload->count / 100 * percent +
+		   workload->count % 100 * percent / 100;
 	r->_do = req;
 }
 
@@ -118,8 +242,30 @@ void nb_workload_reset(struct nb_workload *workload)
 	nb_workload_link(workload);
 }
 
+static inline struct nb_request *
+nb_workload_sample(struct nb_workload *workload)
+{
+	if (workload->alias_size == 0)
+		return NULL;
+	double u = nb_rand_double(workload->rand) * workload->alias_size;
+	int i = (int)u;
+	return u - i < workload->alias_prob[i] ?
+	       workload->alias_req[i] : workload->alias_alt[i];
+}
+
 struct nb_request *nb_workload_fetch(struct nb_workload *workload)
 {
+	if (workload->mix == NB_MIX_RANDOM)
+		return nb_workload_sample(workload);
+	if (workload->mix == NB_MIX_SHUFFLE) {
+		if (workload->schedule_size == 0)
+			return NULL;
+		struct nb_request *r =
+			workload->schedule[workload->schedule_pos++];
+		if (workload->schedule_pos == workload->schedule_size)
+			workload->schedule_pos = 0;
+		return r;
+	}
 	while(1) {
 		if (workload->head == NULL)
 			return NULL;
@@ -31,38 +31,74 @@
  */
 
 #include "nb_db.h"
+#include "nb_rand.h"
 
 enum nb_request_type {
 	NB_REPLACE,
 	NB_UPDATE,
 	NB_DELETE,
 	NB_SELECT,
-	NB_REQUEST_MAX,
-	/* insert doesn't present in tests */
-	NB_INSERT
+	/* A new key, the key space grows. */
+	NB_INSERT,
+	/* Up to a scan length of tuples from a key. */
+	NB_SCAN,
+	/* Batches of multi_key_count keys. */
+	NB_MULTI_SELECT,
+	NB_MULTI_REPLACE,
+	/* A read and a write conditioned by the version read. */
+	NB_RMW,
+	NB_REQUEST_MAX
 };
 
+extern const char *nb_request_type_strs[];
+
 struct nb_request {
 	enum nb_request_type type;
-	int count;
-	int requested;
+	uint64_t count;
+	uint64_t requested;
 	int percent;
 	nb_db_reqf_t _do; 
 	struct nb_request *next, *prev;
 };
 
+/* How the type of the next request is chosen. */
+enum nb_workload_mix {
+	/* Types in turn until each has sent its part of count. */
+	NB_MIX_ROUND_ROBIN,
+	/* Independent draws weighted by percents, by alias table. */
+	NB_MIX_RANDOM,
+	/* A shuffled schedule of the exact proportions, repeated. */
+	NB_MIX_SHUFFLE
+};
+
 struct nb_workload {
-	int count;
-	int count_write;
-	int count_read;
-	int requested, processed;
+	uint64_t count;
+	uint64_t count_write;
+	uint64_t count_read;
+	uint64_t requested, processed;
 	struct nb_request reqs[NB_REQUEST_MAX];
 	struct nb_request *head;
 	struct nb_request *current;
+	enum nb_workload_mix mix;
+	/*
+	 * Alias table of types with nonzero percents: column i is
+	 * alias_req[i] with probability alias_prob[i] and alias_alt[i]
+	 * otherwise.
+	 */
+	int alias_size;
+	struct nb_request *alias_req[NB_REQUEST_MAX];
+	struct nb_request *alias_alt[NB_REQUEST_MAX];
+	double alias_prob[NB_REQUEST_MAX];
+	struct nb_request **schedule;
+	size_t schedule_size;
+	size_t schedule_pos;
+	/* Generator of the thread, NULL for the template workload. */
+	struct nb_rand *rand;
 };
 
-void nb_workload_init(struct nb_workload *workload, int count);
+void nb_workload_init(struct nb_workload *workload, uint64_t count);
 void nb_workload_init_from(struct nb_workload *dest, struct nb_workload *src);
+void nb_workload_free(struct nb_workload *workload);
 void nb_workload_link(struct nb_workload *workload);
 void nb_workload_reset(struct nb_workload *workload);
 
@@ -70,6 +106,13 @@ void nb_workload_add(struct nb_workload *workload, enum nb_request_type type,
 		     nb_db_reqf_t req,
 		     int percent);
 
+/*
+ * Set the mix by its name, @arg schedule_size is the length of
+ * the shuffled schedule. Return -1 if the mix is unknown.
+ */
+int nb_workload_set_mix(struct nb_workload *workload, const char *name,
+			int schedule_size);
+
 struct nb_request *nb_workload_fetch(struct nb_workload *workload);
 
 #endif
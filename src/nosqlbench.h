@@ -36,6 +36,7 @@
 #include "nb_key.h"
 #include "nb_db.h"
 #include "nb_workload.h"
+#include "nb_trace.h"
 #include "nb_stat.h"
 #include "nb_worker.h"
 #include "nb_report.h"
@@ -36,91 +36,111 @@
 #include <math.h>
 #include <assert.h>
 
-/* Numbers were derived from leveldb benchmark to be compatible with it */
-static const double NB_HISTOGRAM_BUCKETS[] = {
-	1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 12, 14, 16, 18, 20, 25, 30, 35, 40, 45,
-	50, 60, 70, 80, 90, 100, 120, 140, 160, 180, 200, 250, 300, 350, 400, 450,
-	500, 600, 700, 800, 900, 1000, 1200, 1400, 1600, 1800, 2000, 2500, 3000,
-	3500, 4000, 4500, 5000, 6000, 7000, 8000, 9000, 10000, 12000, 14000,
-	16000, 18000, 20000, 25000, 30000, 35000, 40000, 45000, 50000, 60000,
-	70000, 80000, 90000, 100000, 120000, 140000, 160000, 180000, 200000,
-	250000, 300000, 350000, 400000, 450000, 500000, 600000, 700000, 800000,
-	900000, 1000000, 1200000, 1400000, 1600000, 1800000, 2000000, 2500000,
-	3000000, 3500000, 4000000, 4500000, 5000000, 6000000, 7000000, 8000000,
-	9000000, 10000000, 12000000, 14000000, 16000000, 18000000, 20000000,
-	25000000, 30000000, 35000000, 40000000, 45000000, 50000000, 60000000,
-	70000000, 80000000, 90000000, 100000000, 120000000, 140000000, 160000000,
-	180000000, 200000000, 250000000, 300000000, 350000000, 400000000,
-	450000000, 500000000, 600000000, 700000000, 800000000, 900000000,
-	1000000000, 1200000000, 1400000000, 1600000000, 1800000000, 2000000000,
-	2500000000.0, 3000000000.0, 3500000000.0, 4000000000.0, 4500000000.0,
-	5000000000.0, 6000000000.0, 7000000000.0, 8000000000.0, 9000000000.0,
-	1e200, INFINITY,
-};
-
-const size_t NB_HISTOGRAM_BUCKETS_COUNT =
-	sizeof(NB_HISTOGRAM_BUCKETS) / sizeof(*NB_HISTOGRAM_BUCKETS);
-
 struct nb_histogram *
-nb_histogram_new(void)
+nb_histogram_new(int significant_digits)
 {
+	assert(significant_digits >= 1 && significant_digits <= 5);
 	struct nb_histogram *hist = malloc(sizeof(*hist));
 	if (hist == NULL) {
 		fprintf(stderr, "malloc(%zu) failed", sizeof(*hist));
 		return NULL;
 	}
-	hist->buckets = calloc(NB_HISTOGRAM_BUCKETS_COUNT, sizeof(size_t));
-
+	/*
+	 * Values below the sub-bucket count are stored exactly, so it
+	 * must be not less than 2 * 10^digits to keep the precision
+	 * in the upper half of every bucket.
+	 */
+	uint64_t largest_single_unit = 2;
+	for (int i = 0; i < significant_digits; i++)
+		largest_single_unit *= 10;
+	int sub_bucket_count_magnitude = 0;
+	while ((1ull << sub_bucket_count_magnitude) < largest_single_unit)
+		sub_bucket_count_magnitude++;
+	hist->significant_digits = significant_digits;
+	hist->sub_bucket_half_count_magnitude = sub_bucket_count_magnitude - 1;
+	hist->sub_bucket_count = 1u << sub_bucket_count_magnitude;
+	hist->sub_bucket_half_count = hist->sub_bucket_count / 2;
+	hist->sub_bucket_mask = hist->sub_bucket_count - 1;
+	/* Buckets are doubled until NB_HISTOGRAM_MAX_VALUE is covered. */
+	uint64_t smallest_untrackable = hist->sub_bucket_count;
+	hist->bucket_count = 1;
+	while (smallest_untrackable <= NB_HISTOGRAM_MAX_VALUE) {
+		smallest_untrackable <<= 1;
+		hist->bucket_count++;
+	}
+	hist->counts_len = (size_t)(hist->bucket_count + 1) *
+			   hist->sub_bucket_half_count;
+	hist->counts = calloc(hist->counts_len, sizeof(size_t));
+	if (hist->counts == NULL) {
+		fprintf(stderr, "calloc(%zu) failed",
+			hist->counts_len * sizeof(size_t));
+		free(hist);
+		return NULL;
+	}
 	nb_histogram_clear(hist);
 	return hist;
 }
 
+static inline size_t
+nb_histogram_index(const struct nb_histogram *hist, uint64_t val)
+{
+	/* Position of the highest bit, but at least the sub-bucket one. */
+	int pow2ceiling = 64 - __builtin_clzll(val | hist->sub_bucket_mask);
+	int bucket_index = pow2ceiling -
+			   (hist->sub_bucket_half_count_magnitude + 1);
+	uint32_t sub_bucket_index = (uint32_t)(val >> bucket_index);
+	return ((size_t)(bucket_index + 1) <<
+		hist->sub_bucket_half_count_magnitude) +
+	       sub_bucket_index - hist->sub_bucket_half_count;
+}
+
+/*
+ * Return the lowest value of the counts slot @index and write the
+ * size of its range of values to @range.
+ */
+static inline uint64_t
+nb_histogram_value(const struct nb_histogram *hist, size_t index,
+		   uint64_t *range)
+{
+	int bucket_index = (int)(index >> hist->sub_bucket_half_count_magnitude)
+			   - 1;
+	uint32_t sub_bucket_index = (index & (hist->sub_bucket_half_count - 1)) +
+				    hist->sub_bucket_half_count;
+	if (bucket_index < 0) {
+		sub_bucket_index -= hist->sub_bucket_half_count;
+		bucket_index = 0;
+	}
+	*range = 1ull << bucket_index;
+	return (uint64_t)sub_bucket_index << bucket_index;
+}
+
 void
 nb_histogram_merge(struct nb_histogram *dest, struct nb_histogram *src)
 {
+	assert(dest->significant_digits == src->significant_digits);
 	if (dest->min > src->min)
 		dest->min = src->min;
 	if (dest->max < src->max)
 		dest->max = src->max;
 	dest->sum += src->sum;
 	dest->size += src->size;
-	for (size_t i = 0; i < NB_HISTOGRAM_BUCKETS_COUNT; ++i) {
-		dest->buckets[i] += src->buckets[i];
+	for (size_t i = 0; i < dest->counts_len; ++i) {
+		dest->counts[i] += src->counts[i];
 	}
 }
 
 void
 nb_histogram_delete(struct nb_histogram *hist)
 {
-	free(hist->buckets);
+	free(hist->counts);
 	free(hist);
 }
 
 void
-nb_histogram_add(struct nb_histogram *hist, double val)
+nb_histogram_add(struct nb_histogram *hist, uint64_t val)
 {
-	size_t begin = 0;
-	size_t end = NB_HISTOGRAM_BUCKETS_COUNT-1;
-	size_t mid;
-
-	while(1) {
-		mid = begin / 2 + end / 2;
-		if (mid == begin) {
-			for (mid = end; mid > begin; mid--) {
-				if (NB_HISTOGRAM_BUCKETS[mid-1] < val) {
-					break;
-				}
-			}
-			break;
-		}
-
-		if (NB_HISTOGRAM_BUCKETS[mid-1] < val) {
-			begin = mid;
-		} else {
-			end = mid;
-		}
-	};
-
+	if (val > NB_HISTOGRAM_MAX_VALUE)
+		val = NB_HISTOGRAM_MAX_VALUE;
 	if (hist->min > val) {
 		hist->min = val;
 	}
@@ -130,37 +150,37 @@ nb_histogram_add(struct nb_histogram *hist, double val)
 
 	hist->sum += val;
 
-	hist->buckets[mid]++;
+	hist->counts[nb_histogram_index(hist, val)]++;
 	hist->size++;
 }
 
 void
 nb_histogram_clear(struct nb_histogram *hist)
 {
-	size_t *tmp = hist->buckets;
-	memset(hist, 0, sizeof(*hist));
-	hist->buckets = tmp;
 	hist->min = INFINITY;
-	memset(hist->buckets, 0, NB_HISTOGRAM_BUCKETS_COUNT * sizeof(size_t));
+	hist->max = 0;
+	hist->sum = 0;
+	hist->size = 0;
+	memset(hist->counts, 0, hist->counts_len * sizeof(size_t));
 }
 
 double
 nb_histogram_percentile(const struct nb_histogram *hist, double p)
 {
-	size_t threshold = (size_t) hist->size * p;
+	if (hist->size == 0)
+		return 0;
+	size_t threshold = (size_t)ceil(hist->size * p);
+	if (threshold == 0)
+		threshold = 1;
 	size_t count = 0;
 
-	for (size_t b = 0; b < NB_HISTOGRAM_BUCKETS_COUNT; b++) {
-		count += hist->buckets[b];
+	for (size_t i = 0; i < hist->counts_len; i++) {
+		count += hist->counts[i];
 		if (count >= threshold) {
-			size_t left = count - hist->buckets[b];
-			size_t right = count;
-			double left_val = (b>0) ? NB_HISTOGRAM_BUCKETS[b-1] : 0;
-			double right_val = NB_HISTOGRAM_BUCKETS[b];
-			double scale = (double) (threshold - left) /
-				       (right - left);
-
-			double r = left_val + (right_val - left_val) * scale;
+			/* The highest value equivalent to the slot. */
+			uint64_t range;
+			uint64_t low = nb_histogram_value(hist, i, &range);
+			double r = (double)(low + range - 1);
 			if (r < hist->min) {
 				return hist->min;
 			} else if (r > hist->max) {
@@ -176,34 +196,52 @@ nb_histogram_percentile(const struct nb_histogram *hist, double p)
 
 void
 nb_histogram_dump(const struct nb_histogram *hist, const char *interval_units,
-		  double *percentiles, size_t percentiles_size)
+		  double scale, double *percentiles, size_t percentiles_size)
 {
 	assert (hist->size > 0);
-	printf("     count    proportion     interval %5s   \n", interval_units);
-	printf("----------------------------------------------\n");
-	for (size_t i = 0; i < NB_HISTOGRAM_BUCKETS_COUNT; ++i) {
-		if (hist->buckets[i] == 0)
-			continue;
-		double percents = (hist->buckets[i] + 0.0) / hist->size * 100;
-		printf(" %9zu       %5.2lf%%   %7.0lf - %7.0lf  \n",
-		       hist->buckets[i], percents,
-		       (i > 0) ? NB_HISTOGRAM_BUCKETS[i-1] : 0.0,
-		       NB_HISTOGRAM_BUCKETS[i]);
+	printf("     count    proportion          interval %5s        \n",
+	       interval_units);
+	printf("--------------------------------------------------------\n");
+	/* Slots are too many to print, sum them by powers of two. */
+	int magnitude = 0;
+	size_t count = 0;
+	for (size_t i = 0; i <= hist->counts_len; ++i) {
+		uint64_t range, low = 0;
+		int m = 65;
+		if (i < hist->counts_len) {
+			low = nb_histogram_value(hist, i, &range);
+			m = low == 0 ? 0 : 64 - __builtin_clzll(low);
+		}
+		if (m != magnitude) {
+			if (count != 0) {
+				double percents = (count + 0.0) / hist->size * 100;
+				double from = magnitude == 0 ? 0.0 :
+					      ldexp(1, magnitude - 1);
+				printf(" %9zu       %5.2lf%%   %12.3lf - %12.3lf  \n",
+				       count, percents, from * scale,
+				       ldexp(1, magnitude) * scale);
+			}
+			count = 0;
+			magnitude = m;
+		}
+		if (i < hist->counts_len)
+			count += hist->counts[i];
 	}
 
 	double avg_latency = hist->sum / hist->size;
 
-	printf("----------------------------------------------\n");
+	printf("--------------------------------------------------------\n");
 	printf("Total %5s: %.2lf; count: %zu\n", interval_units,
-		hist->sum, hist->size);
-	printf("Min latency: %9.2lf %5s\n", hist->min, interval_units);
-	printf("Avg latency: %9.2lf %5s\n", avg_latency, interval_units);
-	printf("Max latency: %9.2lf %5s\n\n", hist->max, interval_units);
+		hist->sum * scale, hist->size);
+	printf("Min latency: %9.2lf %5s\n", hist->min * scale, interval_units);
+	printf("Avg latency: %9.2lf %5s\n", avg_latency * scale,
+	       interval_units);
+	printf("Max latency: %9.2lf %5s\n\n", hist->max * scale,
+	       interval_units);
 
 	for (size_t i = 0; i < percentiles_size; i++) {
 		double p = percentiles[i];
 		printf("%5.2lf%% <   %.2lf\n",
-			p * 100, nb_histogram_percentile(hist, p));
+			p * 100, nb_histogram_percentile(hist, p) * scale);
 	}
 }
-
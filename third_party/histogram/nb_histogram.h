@@ -31,20 +31,46 @@
  */
 
 #include <stdio.h>
+#include <stdint.h>
 
-extern const size_t NB_HISTOGRAM_BUCKETS_COUNT;
-
+/*
+ * Log-linear histogram of integer values in the manner of
+ * HdrHistogram. Values are split into buckets by powers of two and
+ * every bucket is split linearly into sub-buckets, so the value of
+ * any recorded number is kept with the given count of significant
+ * decimal digits. The index of a value is computed by a few bit
+ * operations, no search is done on recording.
+ */
 struct nb_histogram {
 	double min;
 	double max;
 	double sum;
 	size_t size;
-	size_t *buckets;
+	/* Count of significant decimal digits of values. */
+	int significant_digits;
+	/* log2 of the count of sub-buckets in half of a bucket. */
+	int sub_bucket_half_count_magnitude;
+	uint32_t sub_bucket_count;
+	uint32_t sub_bucket_half_count;
+	uint64_t sub_bucket_mask;
+	uint32_t bucket_count;
+	size_t counts_len;
+	size_t *counts;
 };
 
+/* Values greater than this are recorded as this value. */
+#define NB_HISTOGRAM_MAX_VALUE ((1ull << 44) - 1)
+
+/*
+ * Create a histogram that keeps values with @significant_digits
+ * decimal digits of precision (1..5).
+ */
 struct nb_histogram *
-nb_histogram_new(void);
+nb_histogram_new(int significant_digits);
 
+/*
+ * Add counts of src to dest, both must have the same precision.
+ */
 void
 nb_histogram_merge(struct nb_histogram *dest, struct nb_histogram *src);
 
@@ -52,16 +78,24 @@ void
 nb_histogram_delete(struct nb_histogram *hist);
 
 void
-nb_histogram_add(struct nb_histogram *hist, double val);
+nb_histogram_add(struct nb_histogram *hist, uint64_t val);
 
 void
 nb_histogram_clear(struct nb_histogram *hist);
 
+/*
+ * Return the value that is not less than part p (0..1) of recorded
+ * values, with the precision of the histogram.
+ */
 double
 nb_histogram_percentile(const struct nb_histogram *hist, double p);
 
+/*
+ * Print the histogram, values are multiplied by @scale to get them
+ * in @interval_units.
+ */
 void
 nb_histogram_dump(const struct nb_histogram *hist, const char *interval_units,
-		  double *percentiles, size_t percentiles_size);
+		  double scale, double *percentiles, size_t percentiles_size);
 
 #endif /* NB_HISTOGRAM_H_INCLUDED */